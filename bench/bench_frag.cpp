@@ -0,0 +1,370 @@
+// bench_frag — long-running fragmentation and RSS benchmark
+//
+//   bench_frag [--duration=SEC] [--live-mb=MB] [--sample-ms=MS]
+//              [--allocator=ma|system|both] [--json]
+//
+// Runs phase-changing cycles until the duration is up:
+//   1. fill with small objects (16–256B) up to the live target
+//   2. free 90% of everything at random
+//   3. fill with large objects (1–64KB) up to the live target
+//   4. free 90% at random, repeat
+// The 10% survivors of each phase pin pages the next phase can't reuse as-is,
+// which is where the allocators differ.
+//
+// A sampler thread records RSS (/proc/self/statm), live bytes and, for ma,
+// MA_Stats bytes allocated and free, tagged with the phase running. Over
+// the second half of the run it reports their medians overall (steady
+// state) and per phase. Each allocator runs in a forked child so RSS is
+// not shared.
+
+#include "../include/memalloc/memalloc.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+// ── options ───────────────────────────────────────────────────────────────────
+
+struct Options {
+    double duration_s = 120.0;
+    size_t live_bytes = size_t(256) << 20;
+    int    sample_ms  = 100;
+    bool   run_ma     = true;
+    bool   run_sys    = true;
+    bool   json       = false;
+};
+
+struct Allocator {
+    const char* name;
+    void* (*alloc)(size_t);
+    void  (*release)(void*);
+    bool  is_ma;
+};
+
+static const Allocator MA_ALLOC  = {"ma",     ma_malloc, ma_free, true};
+static const Allocator SYS_ALLOC = {"system", ::malloc,  ::free,  false};
+
+// ── sampling ──────────────────────────────────────────────────────────────────
+
+enum Phase { SMALL_FILL, SMALL_FREE, LARGE_FILL, LARGE_FREE, PHASE_COUNT };
+
+static const char* const PHASE_NAMES[PHASE_COUNT] = {
+    "small fill", "small free", "large fill", "large free",
+};
+
+struct Sample {
+    double t;
+    int    phase;
+    size_t rss;
+    size_t live;
+    size_t ma_allocated;
+    size_t ma_free;
+};
+
+// medians over the second half of the run; ma_* stay 0 for system
+struct Levels {
+    size_t samples;
+    size_t rss;
+    size_t live;
+    size_t ma_allocated;
+    size_t ma_free;
+};
+
+// what the child sends back to the parent
+struct Result {
+    size_t cycles;
+    size_t samples;
+    size_t peak_rss;
+    Levels steady;
+    Levels phases[PHASE_COUNT];
+    double rss_per_live;      // median RSS / live over the second half
+    double peak_rss_per_live; // RSS / live at the sample with the most RSS
+    double int_frag;          // final, ma only: 1 - live / bytes_allocated
+    double ext_frag;          // final, ma only
+};
+
+static size_t read_rss() {
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    unsigned long size = 0, resident = 0;
+    int n = fscanf(f, "%lu %lu", &size, &resident);
+    fclose(f);
+    return n == 2 ? resident * static_cast<size_t>(sysconf(_SC_PAGESIZE)) : 0;
+}
+
+// ── workload ──────────────────────────────────────────────────────────────────
+
+struct Rng {
+    uint64_t s;
+    explicit Rng(uint64_t seed) : s(seed * 0x9E3779B97F4A7C15ULL + 1) {}
+    uint64_t next() {
+        s ^= s >> 12; s ^= s << 25; s ^= s >> 27;
+        return s * 0x2545F4914F6CDD1DULL;
+    }
+    size_t range(size_t lo, size_t hi) { return lo + next() % (hi - lo + 1); }
+};
+
+struct Object {
+    void*  p;
+    size_t size;
+};
+
+static void fill(const Allocator& a, std::vector<Object>& live, std::atomic<size_t>& live_bytes,
+                 size_t target, size_t lo, size_t hi, Rng& rng) {
+    while (live_bytes.load(std::memory_order_relaxed) < target) {
+        size_t size = rng.range(lo, hi);
+        void*  p    = a.alloc(size);
+        if (!p) return;
+        memset(p, 0x5A, size);
+        live.push_back({p, size});
+        live_bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+}
+
+static void free_random(const Allocator& a, std::vector<Object>& live,
+                        std::atomic<size_t>& live_bytes, double fraction, Rng& rng) {
+    // Fisher–Yates the victims to the tail, then drop the tail
+    size_t n = static_cast<size_t>(live.size() * fraction);
+    for (size_t i = 0; i < n; i++) {
+        size_t j = live.size() - 1 - i;
+        std::swap(live[rng.next() % (j + 1)], live[j]);
+    }
+    for (size_t i = live.size() - n; i < live.size(); i++) {
+        a.release(live[i].p);
+        live_bytes.fetch_sub(live[i].size, std::memory_order_relaxed);
+    }
+    live.resize(live.size() - n);
+}
+
+static double median(std::vector<double> v) {
+    if (v.empty()) return 0.0;
+    std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+    return v[v.size() / 2];
+}
+
+// samples from time from on, in one phase or (phase < 0) all of them
+static Levels levels(const std::vector<Sample>& samples, double from, int phase) {
+    std::vector<double> rss, live, allocated, free_bytes;
+    for (const Sample& s : samples) {
+        if (s.t < from || (phase >= 0 && s.phase != phase)) continue;
+        rss.push_back(double(s.rss));
+        live.push_back(double(s.live));
+        allocated.push_back(double(s.ma_allocated));
+        free_bytes.push_back(double(s.ma_free));
+    }
+    return {rss.size(), size_t(median(rss)), size_t(median(live)),
+            size_t(median(allocated)), size_t(median(free_bytes))};
+}
+
+static Result run(const Allocator& a, const Options& opt) {
+    using clock = std::chrono::steady_clock;
+
+    std::vector<Object> live;
+    live.reserve(opt.live_bytes / 16 + 1);
+    std::atomic<size_t> live_bytes{0};
+    std::atomic<int>    phase{SMALL_FILL};
+    std::atomic<bool>   done{false};
+    std::vector<Sample> samples;
+
+    auto start = clock::now();
+    std::thread sampler([&]() {
+        while (!done.load(std::memory_order_relaxed)) {
+            Sample s{};
+            s.t     = std::chrono::duration<double>(clock::now() - start).count();
+            s.phase = phase.load(std::memory_order_relaxed);
+            s.rss   = read_rss();
+            s.live  = live_bytes.load(std::memory_order_relaxed);
+            if (a.is_ma) {
+                MA_Stats st;
+                ma_stats(&st);
+                s.ma_allocated = st.bytes_allocated;
+                s.ma_free      = st.bytes_free;
+            }
+            samples.push_back(s);
+            std::this_thread::sleep_for(std::chrono::milliseconds(opt.sample_ms));
+        }
+    });
+
+    Rng    rng(42);
+    size_t cycles = 0;
+    auto   deadline = start + std::chrono::duration<double>(opt.duration_s);
+    while (clock::now() < deadline) {
+        phase.store(SMALL_FILL, std::memory_order_relaxed);
+        fill(a, live, live_bytes, opt.live_bytes, 16, 256, rng);
+        phase.store(SMALL_FREE, std::memory_order_relaxed);
+        free_random(a, live, live_bytes, 0.9, rng);
+        phase.store(LARGE_FILL, std::memory_order_relaxed);
+        fill(a, live, live_bytes, opt.live_bytes, 1024, 64 * 1024, rng);
+        phase.store(LARGE_FREE, std::memory_order_relaxed);
+        free_random(a, live, live_bytes, 0.9, rng);
+        cycles++;
+    }
+
+    done.store(true);
+    sampler.join();
+
+    Result r{};
+    r.cycles  = cycles;
+    r.samples = samples.size();
+
+    std::vector<double> steady_ratio;
+    double half = std::chrono::duration<double>(clock::now() - start).count() / 2;
+    for (const Sample& s : samples) {
+        if (s.rss > r.peak_rss) {
+            r.peak_rss          = s.rss;
+            r.peak_rss_per_live = s.live ? double(s.rss) / double(s.live) : 0.0;
+        }
+        if (s.t >= half && s.live) steady_ratio.push_back(double(s.rss) / double(s.live));
+    }
+    r.rss_per_live = median(steady_ratio);
+    r.steady       = levels(samples, half, -1);
+    for (int p = 0; p < PHASE_COUNT; p++) r.phases[p] = levels(samples, half, p);
+
+    if (a.is_ma) {
+        MA_Stats st;
+        ma_stats(&st);
+        // bytes_requested is cumulative, so measure against our own live count
+        r.int_frag = st.bytes_allocated
+            ? 1.0 - double(live_bytes.load()) / double(st.bytes_allocated) : 0.0;
+        r.ext_frag = st.bytes_free
+            ? 1.0 - double(st.largest_free_block) / double(st.bytes_free) : 0.0;
+    }
+
+    for (const Object& o : live) a.release(o.p);
+    return r;
+}
+
+// run in a forked child so each allocator starts from a clean address space
+static bool run_isolated(const Allocator& a, const Options& opt, Result* out) {
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        close(fds[0]);
+        Result r = run(a, opt);
+        ssize_t n = write(fds[1], &r, sizeof(r));
+        _exit(n == static_cast<ssize_t>(sizeof(r)) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    ssize_t n = read(fds[0], out, sizeof(*out));
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return n == static_cast<ssize_t>(sizeof(*out)) && WIFEXITED(status) &&
+           WEXITSTATUS(status) == 0;
+}
+
+// ── reporting ─────────────────────────────────────────────────────────────────
+
+static double mib(size_t bytes) {
+    return bytes / 1048576.0;
+}
+
+// RSS and live, then the allocator's own view where there is one
+static void print_levels(const char* label, const Levels& l, bool is_ma) {
+    printf("  %-12s %8zu %10.1f %10.1f", label, l.samples, mib(l.rss), mib(l.live));
+    if (is_ma) printf(" %10.1f %10.1f", mib(l.ma_allocated), mib(l.ma_free));
+    printf("\n");
+}
+
+static void print_text(const Allocator& a, const Result& r) {
+    printf("%-8s %8zu %10.1f %12.1f %10.2f %10.2f", a.name, r.cycles,
+           mib(r.peak_rss), mib(r.steady.rss), r.rss_per_live, r.peak_rss_per_live);
+    if (a.is_ma)
+        printf(" %9.1f%% %9.1f%%", r.int_frag * 100.0, r.ext_frag * 100.0);
+    printf("\n");
+
+    printf("  %-12s %8s %10s %10s", "second half", "samples", "RSS MiB", "live MiB");
+    if (a.is_ma) printf(" %10s %10s", "alloc MiB", "free MiB");
+    printf("\n");
+    print_levels("steady", r.steady, a.is_ma);
+    for (int p = 0; p < PHASE_COUNT; p++) print_levels(PHASE_NAMES[p], r.phases[p], a.is_ma);
+}
+
+static void print_levels_json(const Levels& l, bool is_ma) {
+    printf("{\"samples\":%zu,\"rss\":%zu,\"live\":%zu", l.samples, l.rss, l.live);
+    if (is_ma) printf(",\"ma_allocated\":%zu,\"ma_free\":%zu", l.ma_allocated, l.ma_free);
+    printf("}");
+}
+
+static void print_json(const Allocator& a, const Result& r, bool first) {
+    printf("%s{\"allocator\":\"%s\",\"cycles\":%zu,\"samples\":%zu,\"peak_rss\":%zu,"
+           "\"steady_rss\":%zu,\"rss_per_live\":%.4f,\"peak_rss_per_live\":%.4f",
+           first ? "" : ",", a.name, r.cycles, r.samples, r.peak_rss, r.steady.rss,
+           r.rss_per_live, r.peak_rss_per_live);
+    if (a.is_ma)
+        printf(",\"internal_frag\":%.4f,\"external_frag\":%.4f", r.int_frag, r.ext_frag);
+
+    printf(",\"steady\":");
+    print_levels_json(r.steady, a.is_ma);
+    printf(",\"phases\":{");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        printf("%s\"%s\":", p ? "," : "", PHASE_NAMES[p]);
+        print_levels_json(r.phases[p], a.is_ma);
+    }
+    printf("}}");
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (!strncmp(arg, "--duration=", 11)) {
+            opt.duration_s = atof(arg + 11);
+        } else if (!strncmp(arg, "--live-mb=", 10)) {
+            opt.live_bytes = static_cast<size_t>(atol(arg + 10)) << 20;
+        } else if (!strncmp(arg, "--sample-ms=", 12)) {
+            opt.sample_ms = std::max(1, atoi(arg + 12));
+        } else if (!strcmp(arg, "--allocator=ma")) {
+            opt.run_sys = false;
+        } else if (!strcmp(arg, "--allocator=system")) {
+            opt.run_ma = false;
+        } else if (!strcmp(arg, "--allocator=both")) {
+            opt.run_ma = opt.run_sys = true;
+        } else if (!strcmp(arg, "--json")) {
+            opt.json = true;
+        } else {
+            fprintf(stderr, "usage: %s [--duration=SEC] [--live-mb=MB] [--sample-ms=MS]"
+                            " [--allocator=ma|system|both] [--json]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<const Allocator*> allocs;
+    if (opt.run_ma)  allocs.push_back(&MA_ALLOC);
+    if (opt.run_sys) allocs.push_back(&SYS_ALLOC);
+
+    if (opt.json) printf("{\"duration_s\":%.1f,\"live_bytes\":%zu,\"results\":[",
+                         opt.duration_s, opt.live_bytes);
+    else printf("%-8s %8s %10s %12s %10s %10s %10s %10s\n", "alloc", "cycles",
+                "peak MiB", "steady MiB", "RSS/live", "peak/live", "int frag", "ext frag");
+
+    bool ok = true;
+    bool first = true;
+    for (size_t i = 0; i < allocs.size(); i++) {
+        Result r;
+        if (!run_isolated(*allocs[i], opt, &r)) {
+            fprintf(stderr, "%s: run failed\n", allocs[i]->name);
+            ok = false;
+            continue;
+        }
+        if (opt.json) print_json(*allocs[i], r, first);
+        else          print_text(*allocs[i], r);
+        first = false;
+    }
+
+    if (opt.json) printf("]}\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,201 @@
+// bench_internal — micro-benchmarks for the allocator's internal layers
+//
+// Links the private headers and drives each subsystem directly, so a
+// regression in bench_memalloc can be pinned on the layer that caused it:
+//
+//   BM_SlabRunInit/class       carve a 64KB run into a class's free list
+//   BM_SlabRunAllocFree/class  owner alloc + free on one run
+//   BM_SlabRunDrain/queued     drain N remote frees into local_free
+//   BM_ArenaAllocScan/holes    first-fit past N too-small free blocks
+//   BM_ArenaAllocFree/size     steady-state alloc + free (LIFO reuse)
+//   BM_TlsHit / BM_TlsMiss     thread cache pop vs refill from the run
+//
+// Setup that isn't part of the measured path runs outside the timer
+// (manual timing), so per-iteration numbers are the layer's own cost.
+
+#include "../src/internal.h"
+#include "../src/platform.h"
+#include "../src/slab.h"
+#include "../src/arena.h"
+#include "../src/tls_cache.h"
+
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <vector>
+
+using namespace ma;
+using bench_clock = std::chrono::steady_clock;
+
+static double seconds_since(bench_clock::time_point t0) {
+    return std::chrono::duration<double>(bench_clock::now() - t0).count();
+}
+
+// a RUN_SIZE-aligned scratch run, unmapped at scope exit
+struct ScratchRun {
+    void* mem = platform::vm_alloc_aligned(RUN_SIZE, RUN_SIZE);
+    ~ScratchRun() { platform::vm_free(mem, RUN_SIZE); }
+};
+
+// 8B, 64B, 128B, 256B, 512B
+static void size_classes(benchmark::internal::Benchmark* b) {
+    for (int cls : {0, 7, 15, 31, 63}) b->Arg(cls);
+    b->ArgName("class");
+}
+
+// ── slab ──────────────────────────────────────────────────────────────────────
+
+static void BM_SlabRunInit(benchmark::State& state) {
+    ScratchRun scratch;
+    uint32_t   cls = static_cast<uint32_t>(state.range(0));
+
+    for (auto _ : state) {
+        SlabRun* run = slab_run_init(scratch.mem, cls);
+        benchmark::DoNotOptimize(run);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * int64_t(RUN_SIZE));
+}
+BENCHMARK(BM_SlabRunInit)->Apply(size_classes);
+
+static void BM_SlabRunAllocFree(benchmark::State& state) {
+    ScratchRun scratch;
+    SlabRun*   run = slab_run_init(scratch.mem, static_cast<uint32_t>(state.range(0)));
+
+    for (auto _ : state) {
+        void* p = slab_run_alloc(run);
+        benchmark::DoNotOptimize(p);
+        slab_run_free(run, p);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SlabRunAllocFree)->Apply(size_classes);
+
+static void BM_SlabRunDrain(benchmark::State& state) {
+    ScratchRun scratch;
+    SlabRun*   run    = slab_run_init(scratch.mem, 0);
+    size_t     queued = static_cast<size_t>(state.range(0));
+    uint32_t   owner  = run->owner_tid;
+
+    std::vector<void*> blocks(queued);
+    for (auto _ : state) {
+        for (size_t i = 0; i < queued; i++) blocks[i] = slab_run_alloc(run);
+
+        // free as a stranger so the blocks land on remote_free
+        run->owner_tid = ~owner;
+        for (void* p : blocks) slab_run_free(run, p);
+        run->owner_tid = owner;
+
+        auto t0 = bench_clock::now();
+        slab_run_drain_remote(run);
+        state.SetIterationTime(seconds_since(t0));
+    }
+    state.SetItemsProcessed(state.iterations() * int64_t(queued));
+}
+BENCHMARK(BM_SlabRunDrain)
+    ->ArgName("queued")->Arg(1)->Arg(16)->Arg(256)->Arg(4096)
+    ->UseManualTime();
+
+// ── arena ─────────────────────────────────────────────────────────────────────
+
+// Free-list shape, head first:
+//
+//   [holes × 64B] [targets × 1KB] [rest of region]
+//
+// Every hole and target sits between two live pins so nothing coalesces.
+// Targets are exact fits, so a timed arena_alloc scans all the holes, takes
+// the first target whole and leaves the shape intact for the next one.
+static void BM_ArenaAllocScan(benchmark::State& state) {
+    static constexpr size_t SMALL   = 64;
+    static constexpr size_t TARGET  = 1024;
+    static constexpr size_t BATCH   = 256;
+
+    arena_init();
+    size_t holes = static_cast<size_t>(state.range(0));
+
+    std::vector<void*> pins, hole_blocks, targets(BATCH);
+    for (auto _ : state) {
+        pins.clear();
+        hole_blocks.clear();
+
+        // carved front to back from the region's tail block
+        for (size_t i = 0; i < BATCH; i++) {
+            targets[i] = arena_alloc(TARGET);
+            pins.push_back(arena_alloc(SMALL));
+        }
+        for (size_t i = 0; i < holes; i++) {
+            hole_blocks.push_back(arena_alloc(SMALL));
+            pins.push_back(arena_alloc(SMALL));
+        }
+        // LIFO insert: free targets first so the holes end up in front
+        for (void* p : targets)     arena_free(p);
+        for (void* p : hole_blocks) arena_free(p);
+
+        auto t0 = bench_clock::now();
+        for (size_t i = 0; i < BATCH; i++) targets[i] = arena_alloc(TARGET);
+        state.SetIterationTime(seconds_since(t0));
+
+        // everything coalesces back into the tail block
+        for (void* p : targets) arena_free(p);
+        for (void* p : pins)    arena_free(p);
+    }
+    state.SetItemsProcessed(state.iterations() * int64_t(BATCH));
+}
+BENCHMARK(BM_ArenaAllocScan)
+    ->ArgName("holes")->Arg(0)->Arg(16)->Arg(256)->Arg(4096)
+    ->UseManualTime();
+
+static void BM_ArenaAllocFree(benchmark::State& state) {
+    arena_init();
+    size_t size = static_cast<size_t>(state.range(0));
+
+    for (auto _ : state) {
+        void* p = arena_alloc(size);
+        benchmark::DoNotOptimize(p);
+        arena_free(p);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ArenaAllocFree)->ArgName("size")->Arg(1024)->Arg(16384)->Arg(262144);
+
+// ── thread cache ──────────────────────────────────────────────────────────────
+
+static void BM_TlsHit(benchmark::State& state) {
+    // prime: the first free parks the block in this thread's cache
+    void* p = tls_alloc(64);
+    tls_free(p, slab_run_of(p));
+
+    for (auto _ : state) {
+        p = tls_alloc(64);
+        benchmark::DoNotOptimize(p);
+        tls_free(p, slab_run_of(p));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TlsHit);
+
+// Empty cache, so every tls_alloc goes to refill_from_run. Blocks go back
+// straight to the run (not the cache) outside the timer.
+static void BM_TlsMiss(benchmark::State& state) {
+    static constexpr size_t BATCH = 512;
+    static constexpr size_t SIZE  = 64;
+
+    PerClassCache& pc = tls_get()->classes[size_class(SIZE)];
+    std::vector<void*> blocks(BATCH);
+
+    for (auto _ : state) {
+        while (pc.head) {
+            void* p = tls_alloc(SIZE);
+            slab_run_free(slab_run_of(p), p);
+        }
+
+        auto t0 = bench_clock::now();
+        for (size_t i = 0; i < BATCH; i++) blocks[i] = tls_alloc(SIZE);
+        state.SetIterationTime(seconds_since(t0));
+
+        for (void* p : blocks) slab_run_free(slab_run_of(p), p);
+    }
+    state.SetItemsProcessed(state.iterations() * int64_t(BATCH));
+}
+BENCHMARK(BM_TlsMiss)->UseManualTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,345 @@
+// bench_latency — per-call tail latency of ma_malloc / ma_free
+//
+//   bench_latency [--threads=1,2,4,8] [--ops=N] [--live=N] [--timer=tsc|clock] [--json]
+//
+// Every call is timed individually and recorded in a log-linear (HDR-style)
+// histogram per operation and size band. The allocator tags each call with
+// the slow paths it took (refill, new run, new region, arena lock wait), so
+// the report also shows which path the tail comes from.
+//
+// Workload per thread: a window of --live objects with random sizes drawn
+// across all bands; every step frees the oldest object and allocates a new one.
+
+#include "../include/memalloc/memalloc.h"
+#include "../src/stats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define MA_HAVE_TSC 1
+#else
+#define MA_HAVE_TSC 0
+#endif
+
+// ── timing ────────────────────────────────────────────────────────────────────
+
+static bool   g_use_tsc     = MA_HAVE_TSC;
+static double g_ns_per_tick = 1.0;
+
+static inline uint64_t ticks_begin() {
+#if MA_HAVE_TSC
+    if (g_use_tsc) { _mm_lfence(); return __rdtsc(); }
+#endif
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ull + uint64_t(ts.tv_nsec);
+}
+
+static inline uint64_t ticks_end() {
+#if MA_HAVE_TSC
+    if (g_use_tsc) { unsigned aux; uint64_t t = __rdtscp(&aux); _mm_lfence(); return t; }
+#endif
+    return ticks_begin();
+}
+
+static void calibrate() {
+    if (!g_use_tsc) { g_ns_per_tick = 1.0; return; }
+    auto     w0 = std::chrono::steady_clock::now();
+    uint64_t t0 = ticks_begin();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    uint64_t t1 = ticks_end();
+    auto     w1 = std::chrono::steady_clock::now();
+    g_ns_per_tick = std::chrono::duration<double, std::nano>(w1 - w0).count() / double(t1 - t0);
+}
+
+// ── histogram ─────────────────────────────────────────────────────────────────
+// bucket = (position of the top bit, next SUB_BITS bits): ~3% relative error
+
+struct Histogram {
+    static constexpr int SUB_BITS = 5;
+    static constexpr int SUBS     = 1 << SUB_BITS;
+
+    uint64_t counts[64][SUBS] = {};
+    uint64_t total = 0;
+    uint64_t max   = 0;
+
+    static void bucket(uint64_t v, int* major, int* minor) {
+        if (v < SUBS) { *major = 0; *minor = int(v); return; }
+        int msb = 63 - __builtin_clzll(v);
+        *major  = msb - SUB_BITS + 1;
+        *minor  = int((v >> (msb - SUB_BITS)) & (SUBS - 1));
+    }
+
+    static uint64_t lower_bound(int major, int minor) {
+        if (major == 0) return uint64_t(minor);
+        return uint64_t(SUBS | minor) << (major - 1);
+    }
+
+    void record(uint64_t v) {
+        int a, b;
+        bucket(v, &a, &b);
+        counts[a][b]++;
+        total++;
+        if (v > max) max = v;
+    }
+
+    void merge(const Histogram& o) {
+        for (int a = 0; a < 64; a++)
+            for (int b = 0; b < SUBS; b++) counts[a][b] += o.counts[a][b];
+        total += o.total;
+        if (o.max > max) max = o.max;
+    }
+
+    uint64_t percentile(double p) const {
+        if (!total) return 0;
+        uint64_t rank = static_cast<uint64_t>(p * double(total - 1)) + 1, seen = 0;
+        for (int a = 0; a < 64; a++) {
+            for (int b = 0; b < SUBS; b++) {
+                seen += counts[a][b];
+                if (seen >= rank) return std::min(lower_bound(a, b), max);
+            }
+        }
+        return max;
+    }
+
+    uint64_t count_at_least(uint64_t v) const {
+        int a0, b0;
+        bucket(v, &a0, &b0);
+        uint64_t n = 0;
+        for (int a = a0; a < 64; a++)
+            for (int b = (a == a0 ? b0 : 0); b < SUBS; b++) n += counts[a][b];
+        return n;
+    }
+};
+
+// ── classification ────────────────────────────────────────────────────────────
+
+enum Op { OP_MALLOC, OP_FREE, OP_COUNT };
+static const char* OP_NAMES[OP_COUNT] = {"malloc", "free"};
+
+struct Band { const char* name; size_t lo, hi; };
+static const Band BANDS[] = {
+    {"8-64",      8,          64},
+    {"65-512",    65,         512},
+    {"513-4K",    513,        4096},
+    {"4K-64K",    4097,       65536},
+    {"64K-1M",    65537,      1 << 20},
+};
+static constexpr int BAND_COUNT = sizeof(BANDS) / sizeof(BANDS[0]);
+
+// most expensive path wins when a call took several
+enum Path { PATH_FAST, PATH_REFILL, PATH_LOCK_WAIT, PATH_NEW_RUN, PATH_NEW_REGION, PATH_COUNT };
+static const char* PATH_NAMES[PATH_COUNT] = {"fast", "refill", "lock wait", "new run", "new region"};
+
+static Path classify(uint32_t mask) {
+    if (mask & ma::SLOW_NEW_REGION) return PATH_NEW_REGION;
+    if (mask & ma::SLOW_NEW_RUN)    return PATH_NEW_RUN;
+    if (mask & ma::SLOW_LOCK_WAIT)  return PATH_LOCK_WAIT;
+    if (mask & ma::SLOW_REFILL)     return PATH_REFILL;
+    return PATH_FAST;
+}
+
+struct ThreadHist {
+    Histogram by_band[OP_COUNT][BAND_COUNT];
+    Histogram by_path[OP_COUNT][PATH_COUNT];
+    Histogram all[OP_COUNT];
+
+    void merge(const ThreadHist& o) {
+        for (int op = 0; op < OP_COUNT; op++) {
+            for (int b = 0; b < BAND_COUNT; b++) by_band[op][b].merge(o.by_band[op][b]);
+            for (int p = 0; p < PATH_COUNT; p++) by_path[op][p].merge(o.by_path[op][p]);
+            all[op].merge(o.all[op]);
+        }
+    }
+};
+
+// ── workload ──────────────────────────────────────────────────────────────────
+
+struct Rng {
+    uint64_t s;
+    explicit Rng(uint64_t seed) : s(seed * 0x9E3779B97F4A7C15ULL + 1) {}
+    uint64_t next() {
+        s ^= s >> 12; s ^= s << 25; s ^= s >> 27;
+        return s * 0x2545F4914F6CDD1DULL;
+    }
+};
+
+struct Live {
+    void* p;
+    int   band;
+};
+
+static void record(ThreadHist& h, Op op, int band, uint64_t ticks, uint32_t mask) {
+    h.by_band[op][band].record(ticks);
+    h.by_path[op][classify(mask)].record(ticks);
+    h.all[op].record(ticks);
+}
+
+static void worker(int tid, size_t ops, size_t live_n, ThreadHist& h) {
+    Rng rng(tid + 1);
+    std::vector<Live> window(live_n, Live{nullptr, 0});
+
+    for (size_t i = 0; i < ops; i++) {
+        Live& slot = window[i % live_n];
+
+        if (slot.p) {
+            ma::tl_slow_path = 0;
+            uint64_t t0 = ticks_begin();
+            ma_free(slot.p);
+            uint64_t t1 = ticks_end();
+            record(h, OP_FREE, slot.band, t1 - t0, ma::tl_slow_path);
+        }
+
+        // small bands dominate, like real traffic
+        uint64_t r    = rng.next();
+        int      band = (r & 0xF) < 8 ? 0 : (r & 0xF) < 13 ? 1 : (r & 0xF) < 15 ? 2
+                      : (r & 0x30) ? 3 : 4;
+        size_t   size = BANDS[band].lo + (r >> 8) % (BANDS[band].hi - BANDS[band].lo + 1);
+
+        ma::tl_slow_path = 0;
+        uint64_t t0 = ticks_begin();
+        void*    p  = ma_malloc(size);
+        uint64_t t1 = ticks_end();
+        record(h, OP_MALLOC, band, t1 - t0, ma::tl_slow_path);
+
+        if (p) static_cast<char*>(p)[0] = 1;
+        slot = {p, band};
+    }
+    for (Live& l : window) ma_free(l.p);
+}
+
+// ── reporting ─────────────────────────────────────────────────────────────────
+
+static uint64_t ns(uint64_t ticks) { return static_cast<uint64_t>(ticks * g_ns_per_tick); }
+
+static void print_row(const char* op, const char* label, const Histogram& h) {
+    printf("  %-7s %-11s %10lu %8lu %8lu %8lu %10lu\n", op, label,
+           (unsigned long)h.total, (unsigned long)ns(h.percentile(0.50)),
+           (unsigned long)ns(h.percentile(0.99)), (unsigned long)ns(h.percentile(0.999)),
+           (unsigned long)ns(h.max));
+}
+
+static void report_text(int threads, const ThreadHist& h) {
+    printf("\n=== threads: %d ===\n", threads);
+    printf("  %-7s %-11s %10s %8s %8s %8s %10s\n", "op", "band", "count", "p50", "p99",
+           "p99.9", "max (ns)");
+    for (int op = 0; op < OP_COUNT; op++)
+        for (int b = 0; b < BAND_COUNT; b++)
+            if (h.by_band[op][b].total) print_row(OP_NAMES[op], BANDS[b].name, h.by_band[op][b]);
+
+    printf("  %-7s %-11s %10s %8s %8s %8s %10s %12s\n", "op", "path", "count", "p50", "p99",
+           "p99.9", "max (ns)", "share >p99");
+    for (int op = 0; op < OP_COUNT; op++) {
+        uint64_t p99  = h.all[op].percentile(0.99);
+        uint64_t slow = h.all[op].count_at_least(p99);
+        for (int p = 0; p < PATH_COUNT; p++) {
+            const Histogram& ph = h.by_path[op][p];
+            if (!ph.total) continue;
+            double share = slow ? 100.0 * double(ph.count_at_least(p99)) / double(slow) : 0.0;
+            printf("  %-7s %-11s %10lu %8lu %8lu %8lu %10lu %11.1f%%\n", OP_NAMES[op],
+                   PATH_NAMES[p], (unsigned long)ph.total, (unsigned long)ns(ph.percentile(0.50)),
+                   (unsigned long)ns(ph.percentile(0.99)), (unsigned long)ns(ph.percentile(0.999)),
+                   (unsigned long)ns(ph.max), share);
+        }
+    }
+}
+
+static void json_hist(const Histogram& h) {
+    printf("{\"count\":%lu,\"p50\":%lu,\"p99\":%lu,\"p999\":%lu,\"max\":%lu}",
+           (unsigned long)h.total, (unsigned long)ns(h.percentile(0.50)),
+           (unsigned long)ns(h.percentile(0.99)), (unsigned long)ns(h.percentile(0.999)),
+           (unsigned long)ns(h.max));
+}
+
+static void report_json(int threads, const ThreadHist& h, bool first) {
+    printf("%s{\"threads\":%d", first ? "" : ",", threads);
+    for (int op = 0; op < OP_COUNT; op++) {
+        printf(",\"%s\":{\"bands\":{", OP_NAMES[op]);
+        bool any = false;
+        for (int b = 0; b < BAND_COUNT; b++) {
+            if (!h.by_band[op][b].total) continue;
+            printf("%s\"%s\":", any ? "," : "", BANDS[b].name);
+            json_hist(h.by_band[op][b]);
+            any = true;
+        }
+        printf("},\"paths\":{");
+        any = false;
+        for (int p = 0; p < PATH_COUNT; p++) {
+            if (!h.by_path[op][p].total) continue;
+            printf("%s\"%s\":", any ? "," : "", PATH_NAMES[p]);
+            json_hist(h.by_path[op][p]);
+            any = true;
+        }
+        printf("}}");
+    }
+    printf("}");
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> thread_counts = {1, 2, 4, 8};
+    size_t ops    = 200000;
+    size_t live_n = 4096;
+    bool   json   = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (!strncmp(arg, "--threads=", 10)) {
+            thread_counts.clear();
+            for (const char* p = arg + 10; *p;) {
+                thread_counts.push_back(std::max(1, atoi(p)));
+                while (*p && *p != ',') p++;
+                if (*p == ',') p++;
+            }
+        } else if (!strncmp(arg, "--ops=", 6)) {
+            ops = static_cast<size_t>(atol(arg + 6));
+        } else if (!strncmp(arg, "--live=", 7)) {
+            live_n = std::max<size_t>(1, static_cast<size_t>(atol(arg + 7)));
+        } else if (!strcmp(arg, "--timer=clock")) {
+            g_use_tsc = false;
+        } else if (!strcmp(arg, "--timer=tsc")) {
+            g_use_tsc = MA_HAVE_TSC;
+        } else if (!strcmp(arg, "--json")) {
+            json = true;
+        } else {
+            fprintf(stderr, "usage: %s [--threads=1,2,4,8] [--ops=N] [--live=N]"
+                            " [--timer=tsc|clock] [--json]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    calibrate();
+    if (json) printf("{\"timer\":\"%s\",\"ops_per_thread\":%zu,\"runs\":[",
+                     g_use_tsc ? "tsc" : "clock", ops);
+    else printf("timer: %s (%.3f ns/tick), %zu ops per thread, %zu live\n",
+                g_use_tsc ? "tsc" : "clock_gettime", g_ns_per_tick, ops, live_n);
+
+    for (size_t t = 0; t < thread_counts.size(); t++) {
+        int n = thread_counts[t];
+        std::vector<ThreadHist*> hists;
+        std::vector<std::thread> threads;
+        for (int i = 0; i < n; i++) hists.push_back(new ThreadHist());
+        for (int i = 0; i < n; i++)
+            threads.emplace_back(worker, i, ops, live_n, std::ref(*hists[i]));
+        for (auto& th : threads) th.join();
+
+        ThreadHist* merged = new ThreadHist();
+        for (ThreadHist* h : hists) { merged->merge(*h); delete h; }
+
+        if (json) report_json(n, *merged, t == 0);
+        else      report_text(n, *merged);
+        delete merged;
+    }
+
+    if (json) printf("]}\n");
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "../include/memalloc/memalloc.h"
+#include "../include/memalloc/fast.h"
 
 #include <benchmark/benchmark.h>
 #include <cstdlib>
@@ -32,6 +33,17 @@ static void BM_SYS_Small(benchmark::State& s) { run_alloc_free(s, sys_malloc, sy
 BENCHMARK(BM_MA_Small)->Threads(1)->Threads(4)->Threads(8);
 BENCHMARK(BM_SYS_Small)->Threads(1)->Threads(4)->Threads(8);
 
+// same size through the inline header path (memalloc/fast.h)
+static void BM_MA_SmallInline(benchmark::State& s) {
+    for (auto _ : s) {
+        void* p = ma::alloc<64>();
+        benchmark::DoNotOptimize(p);
+        ma::free<64>(p);
+    }
+    s.SetItemsProcessed(s.iterations());
+}
+BENCHMARK(BM_MA_SmallInline)->Threads(1)->Threads(4)->Threads(8);
+
 // ── large alloc/free ──────────────────────────────────────────────────────────
 
 static void BM_MA_Large(benchmark::State& s)  { run_alloc_free(s, ma_malloc,   ma_free,   65536); }
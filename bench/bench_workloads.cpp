@@ -0,0 +1,239 @@
+#include "../include/memalloc/memalloc.h"
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Standard allocator stress workloads, each run against ma_* and glibc.
+//
+//   BM_{MA,SYS}_Larson     server simulation: random slot replace in a shared
+//                          pool, so most frees hit another thread's object
+//   BM_{MA,SYS}_Xmalloc    producer/consumer pairs — all frees are remote
+//   BM_{MA,SYS}_Threadtest per-thread batch alloc then batch free
+//   BM_{MA,SYS}_Mstress    random sizes and lifetimes, some objects migrate
+//   BM_{MA,SYS}_LogNormal  log-normal request sizes with a rolling live set
+//
+// JSON for rollout comparisons:
+//   ./bench_memalloc --benchmark_filter='Larson|Xmalloc|Threadtest|Mstress|LogNormal'
+//                    --benchmark_out=workloads.json --benchmark_out_format=json
+
+// ── allocators ────────────────────────────────────────────────────────────────
+
+struct MaAlloc {
+    static void* alloc(size_t s) { return ma_malloc(s); }
+    static void  release(void* p) { ma_free(p); }
+};
+
+struct SysAlloc {
+    static void* alloc(size_t s) { return ::malloc(s); }
+    static void  release(void* p) { ::free(p); }
+};
+
+// ── helpers ───────────────────────────────────────────────────────────────────
+
+static constexpr int MAX_THREADS = 16;
+
+// xorshift64* — cheap enough not to show up next to the allocator
+struct Rng {
+    uint64_t s;
+    explicit Rng(uint64_t seed) : s(seed * 0x9E3779B97F4A7C15ULL + 1) {}
+    uint64_t next() {
+        s ^= s >> 12; s ^= s << 25; s ^= s >> 27;
+        return s * 0x2545F4914F6CDD1DULL;
+    }
+    size_t below(size_t n) { return static_cast<size_t>(next() % n); }
+};
+
+static void touch(void* p, size_t size) {
+    // write first and last byte so the benchmark pays for first-touch faults
+    static_cast<char*>(p)[0]        = 1;
+    static_cast<char*>(p)[size - 1] = 1;
+}
+
+static void thread_counts(benchmark::internal::Benchmark* b) {
+    b->ThreadRange(1, MAX_THREADS)->UseRealTime();
+}
+
+static void thread_pairs(benchmark::internal::Benchmark* b) {
+    b->ThreadRange(2, MAX_THREADS)->UseRealTime();
+}
+
+// ── Larson ────────────────────────────────────────────────────────────────────
+// every op replaces a random slot of a pool shared by all threads
+
+static constexpr size_t LARSON_SLOTS    = 8192;
+static constexpr size_t LARSON_MIN_SIZE = 16;
+static constexpr size_t LARSON_MAX_SIZE = 1024;
+
+template <typename A>
+static void larson(benchmark::State& state) {
+    static std::atomic<void*> pool[LARSON_SLOTS];
+    Rng rng(state.thread_index() + 1);
+
+    for (auto _ : state) {
+        size_t size = LARSON_MIN_SIZE + rng.below(LARSON_MAX_SIZE - LARSON_MIN_SIZE);
+        void*  p    = A::alloc(size);
+        touch(p, size);
+        A::release(pool[rng.below(LARSON_SLOTS)].exchange(p, std::memory_order_acq_rel));
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    if (state.thread_index() == 0) {
+        for (auto& slot : pool) A::release(slot.exchange(nullptr));
+    }
+}
+
+// ── xmalloc ───────────────────────────────────────────────────────────────────
+// even threads allocate, odd threads free what their partner produced
+
+static constexpr size_t XMALLOC_RING  = 1024;
+static constexpr size_t XMALLOC_BATCH = 64;
+static constexpr size_t XMALLOC_SIZE  = 64;
+
+struct alignas(64) SpscRing {
+    std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+    alignas(64) void* slots[XMALLOC_RING];
+};
+
+template <typename A>
+static void xmalloc(benchmark::State& state) {
+    static SpscRing rings[MAX_THREADS / 2];
+    SpscRing& ring     = rings[state.thread_index() / 2];
+    bool      producer = (state.thread_index() % 2) == 0;
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < XMALLOC_BATCH; i++) {
+            if (producer) {
+                void* p = A::alloc(XMALLOC_SIZE);
+                touch(p, XMALLOC_SIZE);
+                size_t t = ring.tail.load(std::memory_order_relaxed);
+                while (t - ring.head.load(std::memory_order_acquire) == XMALLOC_RING) {}
+                ring.slots[t % XMALLOC_RING] = p;
+                ring.tail.store(t + 1, std::memory_order_release);
+            } else {
+                size_t h = ring.head.load(std::memory_order_relaxed);
+                while (ring.tail.load(std::memory_order_acquire) == h) {}
+                A::release(ring.slots[h % XMALLOC_RING]);
+                ring.head.store(h + 1, std::memory_order_release);
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * XMALLOC_BATCH);
+}
+
+// ── threadtest ────────────────────────────────────────────────────────────────
+
+static constexpr size_t THREADTEST_OBJECTS = 1000;
+static constexpr size_t THREADTEST_SIZE    = 64;
+
+template <typename A>
+static void threadtest(benchmark::State& state) {
+    std::vector<void*> objs(THREADTEST_OBJECTS);
+
+    for (auto _ : state) {
+        for (auto& p : objs) {
+            p = A::alloc(THREADTEST_SIZE);
+            touch(p, THREADTEST_SIZE);
+        }
+        for (void* p : objs) A::release(p);
+    }
+    state.SetItemsProcessed(state.iterations() * THREADTEST_OBJECTS);
+}
+
+// ── mstress ───────────────────────────────────────────────────────────────────
+// per-thread live set with random sizes (mostly small, some up to 64KB) and
+// random lifetimes; ~1/16 of frees hand the object to a shared transfer pool
+
+static constexpr size_t MSTRESS_LIVE     = 4096;
+static constexpr size_t MSTRESS_TRANSFER = 1024;
+
+static size_t mstress_size(Rng& rng) {
+    uint64_t r = rng.next();
+    if ((r & 0xFF) == 0) return 4096 + (r >> 8) % (60 * 1024);   // rare large
+    if ((r & 0x7) == 0)  return 512 + (r >> 8) % 3584;           // medium
+    return 8 + (r >> 8) % 248;                                   // small
+}
+
+template <typename A>
+static void mstress(benchmark::State& state) {
+    static std::atomic<void*> transfer[MSTRESS_TRANSFER];
+    std::vector<void*> live(MSTRESS_LIVE, nullptr);
+    Rng rng(state.thread_index() + 7);
+
+    for (auto _ : state) {
+        size_t i = rng.below(MSTRESS_LIVE);
+        if (live[i]) {
+            if (rng.below(16) == 0) {
+                void* old = transfer[rng.below(MSTRESS_TRANSFER)]
+                                .exchange(live[i], std::memory_order_acq_rel);
+                A::release(old);
+            } else {
+                A::release(live[i]);
+            }
+            live[i] = nullptr;
+        } else {
+            size_t size = mstress_size(rng);
+            live[i] = A::alloc(size);
+            touch(live[i], size);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    for (void* p : live) A::release(p);
+    if (state.thread_index() == 0) {
+        for (auto& slot : transfer) A::release(slot.exchange(nullptr));
+    }
+}
+
+// ── log-normal sizes ──────────────────────────────────────────────────────────
+// median ~100B with a long tail, clamped to [8B, 1MB]; rolling window of
+// LOGNORMAL_LIVE objects so each alloc is paired with the oldest free
+
+static constexpr size_t LOGNORMAL_LIVE   = 1024;
+static constexpr size_t LOGNORMAL_TABLE  = 4096;
+static constexpr double LOGNORMAL_MU     = 4.6;
+static constexpr double LOGNORMAL_SIGMA  = 1.5;
+
+template <typename A>
+static void lognormal(benchmark::State& state) {
+    std::vector<size_t> sizes(LOGNORMAL_TABLE);
+    std::mt19937_64 gen(state.thread_index() + 11);
+    std::lognormal_distribution<double> dist(LOGNORMAL_MU, LOGNORMAL_SIGMA);
+    for (auto& s : sizes)
+        s = static_cast<size_t>(std::clamp(dist(gen), 8.0, 1024.0 * 1024.0));
+
+    std::vector<void*> window(LOGNORMAL_LIVE, nullptr);
+    size_t n = 0;
+
+    for (auto _ : state) {
+        size_t size = sizes[n % LOGNORMAL_TABLE];
+        void*& slot = window[n % LOGNORMAL_LIVE];
+        A::release(slot);
+        slot = A::alloc(size);
+        touch(slot, size);
+        n++;
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    for (void* p : window) A::release(p);
+}
+
+// ── registration ──────────────────────────────────────────────────────────────
+
+#define MA_WORKLOAD(name, fn, threads)                                      \
+    static void BM_MA_##name(benchmark::State& s)  { fn<MaAlloc>(s); }     \
+    static void BM_SYS_##name(benchmark::State& s) { fn<SysAlloc>(s); }    \
+    BENCHMARK(BM_MA_##name)->Apply(threads);                                \
+    BENCHMARK(BM_SYS_##name)->Apply(threads)
+
+MA_WORKLOAD(Larson,     larson,     thread_counts);
+MA_WORKLOAD(Xmalloc,    xmalloc,    thread_pairs);
+MA_WORKLOAD(Threadtest, threadtest, thread_counts);
+MA_WORKLOAD(Mstress,    mstress,    thread_counts);
+MA_WORKLOAD(LogNormal,  lognormal,  thread_counts);
@@ -0,0 +1,334 @@
+// ma_replay — replay an allocation trace recorded with ma_trace_start
+//
+//   ma_replay <trace> [--allocator=ma|system] [--json]
+//
+// Each recorded thread becomes one replay thread running its own events in
+// order. Pointers are resolved to object ids up front, by walking all events
+// in timestamp order, so a free on thread B of an object allocated on thread
+// A waits until A has allocated it. Only the allocator call itself is timed.
+// RSS is sampled during the replay and reported as growth over the process
+// after loading, so the loader's own memory doesn't count.
+
+#include "../include/memalloc/memalloc.h"
+#include "../src/trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace ma;
+
+// ── trace loading ─────────────────────────────────────────────────────────────
+
+struct RawEvent {
+    TraceEvent ev;
+    uint32_t   tid;
+};
+
+static bool load_trace(const char* path, std::vector<RawEvent>& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) { perror(path); return false; }
+
+    TraceFileHeader hdr;
+    if (fread(&hdr, sizeof(hdr), 1, f) != 1 || hdr.magic != TRACE_MAGIC ||
+        hdr.version != TRACE_VERSION || hdr.event_size != sizeof(TraceEvent)) {
+        fprintf(stderr, "%s: not a mem-alloc trace (or wrong version)\n", path);
+        fclose(f);
+        return false;
+    }
+
+    TraceChunkHeader ch;
+    while (fread(&ch, sizeof(ch), 1, f) == 1) {
+        size_t base = out.size();
+        out.resize(base + ch.count);
+        for (uint32_t i = 0; i < ch.count; i++) {
+            if (fread(&out[base + i].ev, sizeof(TraceEvent), 1, f) != 1) {
+                fprintf(stderr, "%s: truncated chunk\n", path);
+                out.resize(base + i);
+                fclose(f);
+                return true;
+            }
+            out[base + i].tid = ch.tid;
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+// ── resolution: addresses → object ids ────────────────────────────────────────
+
+enum ReplayOp : uint8_t { OP_MALLOC, OP_FREE, OP_REALLOC };
+
+static constexpr uint32_t NO_OBJECT = UINT32_MAX;
+
+struct ReplayEvent {
+    ReplayOp op;
+    uint32_t id;        // object produced (malloc/realloc) or consumed (free)
+    uint32_t old_id;    // realloc input, NO_OBJECT for realloc(NULL, n)
+    size_t   size;
+};
+
+struct Replay {
+    std::vector<std::vector<ReplayEvent>> threads;
+    uint32_t objects = 0;
+    size_t   dropped = 0;   // frees of objects allocated before the trace
+};
+
+static Replay resolve(std::vector<RawEvent>& raw) {
+    // chunks arrive in writer order; timestamps give the true interleaving
+    std::stable_sort(raw.begin(), raw.end(), [](const RawEvent& a, const RawEvent& b) {
+        return a.ev.ts_ns < b.ev.ts_ns;
+    });
+
+    Replay r;
+    std::map<uint32_t, size_t>             thread_index;
+    std::unordered_map<uint64_t, uint32_t> live;
+
+    // A realloc is stamped before its call, so a moved result can show up
+    // while another thread's free of that address, recorded inside the
+    // call, is still to come. The result takes the address after that free.
+    std::unordered_map<uint64_t, uint32_t> pending;
+
+    auto consume = [&](uint64_t addr) -> uint32_t {
+        auto it = live.find(addr);
+        if (it == live.end()) return NO_OBJECT;
+        uint32_t id = it->second;
+        live.erase(it);
+
+        auto p = pending.find(addr);
+        if (p != pending.end()) {
+            live[addr] = p->second;
+            pending.erase(p);
+        }
+        return id;
+    };
+
+    for (const RawEvent& e : raw) {
+        auto [it, inserted] = thread_index.emplace(e.tid, r.threads.size());
+        if (inserted) r.threads.emplace_back();
+        std::vector<ReplayEvent>& t = r.threads[it->second];
+
+        size_t size = trace_size(e.ev);
+        switch (trace_op(e.ev)) {
+        case TRACE_MALLOC:
+            live[e.ev.ptr] = r.objects;
+            t.push_back({OP_MALLOC, r.objects++, NO_OBJECT, size});
+            break;
+
+        case TRACE_FREE: {
+            uint32_t id = consume(e.ev.ptr);
+            if (id == NO_OBJECT) { r.dropped++; break; }
+            t.push_back({OP_FREE, id, NO_OBJECT, 0});
+            break;
+        }
+
+        case TRACE_REALLOC: {
+            if (!e.ev.ptr && size) break;              // failed realloc: no change
+            uint32_t old_id = e.ev.old_ptr ? consume(e.ev.old_ptr) : NO_OBJECT;
+            if (!e.ev.ptr) {                           // realloc(p, 0) == free
+                if (old_id != NO_OBJECT) t.push_back({OP_FREE, old_id, NO_OBJECT, 0});
+                break;
+            }
+            if (live.count(e.ev.ptr)) pending[e.ev.ptr] = r.objects;
+            else                      live[e.ev.ptr]    = r.objects;
+            t.push_back({old_id == NO_OBJECT ? OP_MALLOC : OP_REALLOC,
+                         r.objects++, old_id, size});
+            break;
+        }
+        }
+    }
+    return r;
+}
+
+// ── allocators ────────────────────────────────────────────────────────────────
+
+struct Allocator {
+    void* (*alloc)(size_t);
+    void  (*release)(void*);
+    void* (*resize)(void*, size_t);
+};
+
+static const Allocator MA_ALLOC  = {ma_malloc, ma_free, ma_realloc};
+static const Allocator SYS_ALLOC = {::malloc, ::free, ::realloc};
+
+// ── replay ────────────────────────────────────────────────────────────────────
+
+static uint64_t now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ull + uint64_t(ts.tv_nsec);
+}
+
+static void* wait_for(std::atomic<void*>& slot) {
+    void* p;
+    while (!(p = slot.load(std::memory_order_acquire))) std::this_thread::yield();
+    return p;
+}
+
+struct Latencies {
+    std::vector<uint32_t> ns[3];
+};
+
+static void run_thread(const Allocator& a, const std::vector<ReplayEvent>& events,
+                       std::vector<std::atomic<void*>>& objects, Latencies& lat) {
+    for (const ReplayEvent& e : events) {
+        void* in = nullptr;
+        if (e.op != OP_MALLOC) {
+            uint32_t src = (e.op == OP_FREE) ? e.id : e.old_id;
+            in = wait_for(objects[src]);
+            objects[src].store(nullptr, std::memory_order_relaxed);
+        }
+
+        uint64_t t0  = now_ns();
+        void*    out = nullptr;
+        switch (e.op) {
+        case OP_MALLOC:  out = a.alloc(e.size);      break;
+        case OP_FREE:    a.release(in);              break;
+        case OP_REALLOC: out = a.resize(in, e.size); break;
+        }
+        uint64_t dt = now_ns() - t0;
+        lat.ns[e.op].push_back(static_cast<uint32_t>(std::min<uint64_t>(dt, UINT32_MAX)));
+
+        if (e.op != OP_FREE) {
+            // a failed allocation would leave dependants waiting forever
+            if (!out) out = a.alloc(1);
+            objects[e.id].store(out, std::memory_order_release);
+        }
+    }
+}
+
+static size_t read_rss() {
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    unsigned long size = 0, resident = 0;
+    int n = fscanf(f, "%lu %lu", &size, &resident);
+    fclose(f);
+    return n == 2 ? resident * static_cast<size_t>(sysconf(_SC_PAGESIZE)) : 0;
+}
+
+static uint64_t pct(std::vector<uint32_t>& v, double p) {
+    if (v.empty()) return 0;
+    size_t i = static_cast<size_t>(p * (v.size() - 1));
+    return v[i];
+}
+
+int main(int argc, char** argv) {
+    const char*      path = nullptr;
+    const Allocator* alloc = &MA_ALLOC;
+    const char*      alloc_name = "ma";
+    bool             json = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--allocator=ma")) {
+            alloc = &MA_ALLOC;  alloc_name = "ma";
+        } else if (!strcmp(argv[i], "--allocator=system")) {
+            alloc = &SYS_ALLOC; alloc_name = "system";
+        } else if (!strcmp(argv[i], "--json")) {
+            json = true;
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            fprintf(stderr, "usage: %s <trace> [--allocator=ma|system] [--json]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "usage: %s <trace> [--allocator=ma|system] [--json]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<RawEvent> raw;
+    if (!load_trace(path, raw)) return 1;
+    Replay r = resolve(raw);
+    raw.clear();
+    raw.shrink_to_fit();
+
+    std::vector<std::atomic<void*>> objects(r.objects);
+    std::vector<Latencies>          lat(r.threads.size());
+    for (size_t i = 0; i < r.threads.size(); i++) {
+        size_t n = r.threads[i].size();   // latency pushes must not grow RSS mid-run
+        for (auto& v : lat[i].ns) v.reserve(n);
+    }
+
+    // after loading and resolving: what the replay adds is the allocator's
+    size_t              base_rss = read_rss();
+    std::atomic<size_t> peak_rss{base_rss};
+    std::atomic<bool>   done{false};
+    std::thread sampler([&]() {
+        while (!done.load(std::memory_order_relaxed)) {
+            size_t rss = read_rss();
+            if (rss > peak_rss.load(std::memory_order_relaxed))
+                peak_rss.store(rss, std::memory_order_relaxed);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    uint64_t t0 = now_ns();
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < r.threads.size(); i++) {
+        threads.emplace_back([&, i]() { run_thread(*alloc, r.threads[i], objects, lat[i]); });
+    }
+    for (auto& th : threads) th.join();
+    double secs = (now_ns() - t0) / 1e9;
+
+    done.store(true, std::memory_order_relaxed);
+    sampler.join();
+    size_t end_rss     = read_rss();   // objects live at the end of the trace still held
+    size_t peak        = std::max(peak_rss.load(), end_rss);
+    size_t base_rss_kb = base_rss / 1024;
+    size_t peak_rss_kb = (peak - base_rss) / 1024;
+
+    // objects still live at the end of the trace
+    for (auto& o : objects) alloc->release(o.load(std::memory_order_relaxed));
+
+    static const char* names[3] = {"malloc", "free", "realloc"};
+    std::vector<uint32_t> merged[3];
+    size_t total = 0;
+    for (int op = 0; op < 3; op++) {
+        for (auto& l : lat) merged[op].insert(merged[op].end(), l.ns[op].begin(), l.ns[op].end());
+        std::sort(merged[op].begin(), merged[op].end());
+        total += merged[op].size();
+    }
+
+    if (json) {
+        printf("{\"allocator\":\"%s\",\"threads\":%zu,\"ops\":%zu,\"dropped\":%zu,"
+               "\"seconds\":%.6f,\"ops_per_sec\":%.0f,\"base_rss_kb\":%zu,"
+               "\"peak_rss_growth_kb\":%zu,\"latency_ns\":{",
+               alloc_name, r.threads.size(), total, r.dropped, secs, total / secs, base_rss_kb,
+               peak_rss_kb);
+        for (int op = 0; op < 3; op++) {
+            auto& v = merged[op];
+            printf("%s\"%s\":{\"count\":%zu,\"p50\":%lu,\"p99\":%lu,\"p999\":%lu,\"max\":%lu}",
+                   op ? "," : "", names[op], v.size(), pct(v, 0.50), pct(v, 0.99),
+                   pct(v, 0.999), v.empty() ? 0ul : (unsigned long)v.back());
+        }
+        printf("}}\n");
+        return 0;
+    }
+
+    printf("=== replay: %s (%s) ===\n", path, alloc_name);
+    printf("  threads:     %zu\n", r.threads.size());
+    printf("  ops:         %zu (%zu frees of pre-trace objects dropped)\n", total, r.dropped);
+    printf("  wall time:   %.3f s\n", secs);
+    printf("  throughput:  %.2f M ops/s\n", total / secs / 1e6);
+    printf("  peak RSS:    +%zu KiB over %zu KiB after loading\n", peak_rss_kb, base_rss_kb);
+    printf("  latency (ns)      count        p50        p99      p99.9        max\n");
+    for (int op = 0; op < 3; op++) {
+        auto& v = merged[op];
+        printf("  %-10s %12zu %10lu %10lu %10lu %10lu\n", names[op], v.size(),
+               pct(v, 0.50), pct(v, 0.99), pct(v, 0.999),
+               v.empty() ? 0ul : (unsigned long)v.back());
+    }
+    return 0;
+}
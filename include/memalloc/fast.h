@@ -0,0 +1,123 @@
+#pragma once
+
+// Inline fast path for fixed-size allocations (C++ only).
+//
+//   Node* n = static_cast<Node*>(ma::alloc<sizeof(Node)>());
+//   ...
+//   ma::free<sizeof(Node)>(n);
+//
+// The size class is a template constant, so a hit is a pop from (or push
+// onto) this thread's cache plus the stat updates ma_malloc does — no call.
+// A miss, a full cache, a thread that hasn't allocated yet, a block from
+// another NUMA node's run, or a size over 512 bytes falls back to
+// ma_malloc / ma_free.
+//
+// ma::free<N> must get a block that ma::alloc<N>, or ma_malloc for a size
+// in the same class (N rounded up to 8), returned; ma_free takes blocks
+// from ma::alloc<N> too. Stats stay exact; the inline path is not traced.
+
+#include "memalloc.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace ma {
+namespace detail {
+
+inline constexpr size_t FAST_SMALL_MAX = 512;
+
+// small blocks live in RUN_SIZE-aligned runs whose header records the
+// run's NUMA node as a uint16_t at this offset
+inline constexpr size_t FAST_RUN_SIZE        = 65536;
+inline constexpr size_t FAST_RUN_NODE_OFFSET = 50;
+
+// leading fields of the allocator's per-class thread cache; the cache is an
+// array of these, one cache line apart, indexed by size class
+struct alignas(64) FastBin {
+    void*    head;
+    uint32_t count;
+};
+
+// leading fields of the thread's stat slot (owner stores, readers load)
+struct FastCounters {
+    std::atomic<size_t> requested;
+    std::atomic<size_t> allocated_add;
+    std::atomic<size_t> allocated_sub;
+    std::atomic<size_t> metadata;
+    std::atomic<size_t> slab_inuse_inc;
+    std::atomic<size_t> slab_inuse_dec;
+};
+
+// null until the thread's first ma_malloc, and again once it is exiting;
+// node is the thread's NUMA node, UINT32_MAX until it has one
+struct FastThread {
+    FastBin*      bins;
+    FastCounters* stats;
+    uint32_t      node;
+};
+
+extern constinit thread_local FastThread tl_fast;
+extern std::atomic<size_t>               tcache_max;   // ma_ctl tcache.max
+
+inline void bump(std::atomic<size_t>& c, size_t n) {
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_release);
+}
+
+inline uint32_t run_node(void* p) {
+    uintptr_t base = reinterpret_cast<uintptr_t>(p) & ~(FAST_RUN_SIZE - 1);
+    return *reinterpret_cast<const uint16_t*>(base + FAST_RUN_NODE_OFFSET);
+}
+
+} // namespace detail
+
+template <size_t N>
+inline void* alloc() {
+    static_assert(N > 0, "ma::alloc<0>");
+    if constexpr (N > detail::FAST_SMALL_MAX) {
+        return ma_malloc(N);
+    } else {
+        constexpr size_t cls = (N + 7) / 8 - 1;
+
+        detail::FastThread& t = detail::tl_fast;
+        if (__builtin_expect(t.bins && t.stats, 1)) {
+            detail::FastBin& b = t.bins[cls];
+            if (void* p = b.head) {
+                b.head = *static_cast<void**>(p);
+                b.count--;
+                detail::bump(t.stats->requested, N);
+                detail::bump(t.stats->allocated_add, (cls + 1) * 8);
+                detail::bump(t.stats->slab_inuse_inc, 1);
+                return p;
+            }
+        }
+        return ma_malloc(N);
+    }
+}
+
+template <size_t N>
+inline void free(void* p) {
+    if constexpr (N > detail::FAST_SMALL_MAX) {
+        ma_free(p);
+    } else {
+        constexpr size_t cls = (N + 7) / 8 - 1;
+
+        detail::FastThread& t = detail::tl_fast;
+        if (__builtin_expect(p && t.bins && t.stats, 1)) {
+            detail::FastBin& b = t.bins[cls];
+            // another node's block goes back to its run, not into this cache
+            if (b.count < detail::tcache_max.load(std::memory_order_relaxed) &&
+                detail::run_node(p) == t.node) {
+                *static_cast<void**>(p) = b.head;
+                b.head = p;
+                b.count++;
+                detail::bump(t.stats->allocated_sub, (cls + 1) * 8);
+                detail::bump(t.stats->slab_inuse_dec, 1);
+                return;
+            }
+        }
+        ma_free(p);
+    }
+}
+
+} // namespace ma
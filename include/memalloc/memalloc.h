@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 
 #ifdef __cplusplus
 extern "C" {
@@ -11,6 +12,40 @@ void  ma_free(void* ptr);
 void* ma_realloc(void* ptr, size_t new_size);
 void* ma_calloc(size_t count, size_t size);
 
+// Extended allocation. flags is 0 or an OR of:
+//
+//   MA_MALLOCX_ALIGN(a)     payload aligned to a (power of two); up to 64
+//                           still uses the size classes, above that an
+//                           arena block with room to align it; 0 sets no
+//                           alignment
+//   MA_MALLOCX_ZERO         zeroed (rallocx: the bytes past the old size)
+//   MA_MALLOCX_TCACHE_NONE  skip this thread's cache: the block comes from
+//                           its run (or the arena), and goes back to it on
+//                           free — for blocks another thread will free
+//   MA_MALLOCX_ARENA(i)     allocate from arena i (NUMA node i) as an
+//                           arena block, for small sizes too; i must be
+//                           below arena.count
+//   MA_MALLOCX_NO_MOVE      rallocx only: resize in place or return NULL,
+//                           leaving ptr as it was
+//
+// ma_rallocx first resizes in place: a block in the same size class, or an
+// arena block shrunk or grown into the free block after it. Otherwise it
+// moves, unless NO_MOVE. ma_dallocx honours TCACHE_NONE and ignores the
+// other flags. All three accept and return ordinary ma_malloc blocks. They
+// return NULL, or do nothing, for invalid flags.
+#define MA_MALLOCX_LG_ALIGN(la)   ((int)(la))
+#define MA_MALLOCX_ALIGN(a)       ((a) ? (int)__builtin_ctzll((unsigned long long)(a)) : 0)
+#define MA_MALLOCX_LG_ALIGN_MASK  0x3f
+#define MA_MALLOCX_ZERO           0x40
+#define MA_MALLOCX_TCACHE_NONE    0x80
+#define MA_MALLOCX_NO_MOVE        0x100
+#define MA_MALLOCX_ARENA_SHIFT    20
+#define MA_MALLOCX_ARENA(i)       ((int)(((unsigned)(i) + 1) << MA_MALLOCX_ARENA_SHIFT))
+
+void* ma_mallocx(size_t size, int flags);
+void* ma_rallocx(void* ptr, size_t size, int flags);
+void  ma_dallocx(void* ptr, int flags);
+
 typedef struct {
     size_t bytes_requested;
     size_t bytes_allocated;
@@ -24,6 +59,236 @@ typedef struct {
 void ma_stats(MA_Stats* out);
 void ma_print_stats(void);
 
+// Slow-path event counters, summed over all threads (live and exited).
+// Monotonic: diff two snapshots to measure an interval.
+typedef struct {
+    uint64_t lock_waits;        // contended acquisitions of the arena lock
+    uint64_t lock_wait_ns;      // total time blocked on it
+    uint64_t cas_retries;       // failed CAS in remote-free pushes
+    uint64_t remote_frees;      // blocks freed onto another thread's run
+    uint64_t remote_drains;     // owner drains that found remote frees
+    uint64_t remote_drained;    // blocks reclaimed by those drains
+    uint64_t tcache_refills;    // thread cache misses
+    uint64_t runs_mapped;
+    uint64_t runs_unmapped;
+    uint64_t regions_mapped;
+    uint64_t purged_bytes;      // free arena pages returned by ma_background_start
+} MA_EventStats;
+
+void ma_event_stats(MA_EventStats* out);
+
+// Object caches — fixed-size objects on dedicated slab runs. ctor runs
+// once per object when its run is carved and dtor when an empty run is
+// unmapped; in between, ma_cache_free keeps the object constructed and
+// ma_cache_alloc returns it as it was left. align is a power of two
+// (0 means pointer alignment). Objects up to 8KB; at most 128 live caches.
+// Returns NULL if the arguments don't fit or the table is full.
+//
+// ma_free also accepts a cache object. Destroy only once every object is
+// freed; free objects still cached by other threads are reclaimed when
+// those threads exit.
+typedef struct MA_Cache MA_Cache;
+
+MA_Cache* ma_cache_create(size_t size, size_t align,
+                          void (*ctor)(void*), void (*dtor)(void*));
+void      ma_cache_destroy(MA_Cache* cache);
+void*     ma_cache_alloc(MA_Cache* cache);
+void      ma_cache_free(MA_Cache* cache, void* obj);
+
+// Allocation tracing — requires a build with -DENABLE_TRACE=ON.
+// Records ma_malloc/ma_free/ma_realloc into a binary trace for ma_replay.
+// Setting MEMALLOC_TRACE=<path> starts a trace on first allocation.
+// Returns 0 on success, -1 if tracing is compiled out, already running,
+// or the file can't be opened. Always -1 in an ENABLE_SINGLE_THREADED
+// build, which can't run the writer thread.
+int  ma_trace_start(const char* path);
+void ma_trace_stop(void);
+
+// Background maintenance — an optional thread that, every interval_ms,
+// returns free arena pages unused for decay_ms to the OS, unmaps slab runs
+// that emptied after their thread moved on or exited, and folds exited
+// threads' stats. NULL config uses background.interval_ms and
+// arena.decay_ms (100 ms / 1000 ms unless changed through ma_ctl).
+// Returns 0 on success, -1 if already running or interval_ms is 0, and
+// always -1 in an ENABLE_SINGLE_THREADED build.
+typedef struct {
+    unsigned interval_ms;
+    unsigned decay_ms;
+} MA_BackgroundConfig;
+
+int  ma_background_start(const MA_BackgroundConfig* config);
+void ma_background_stop(void);
+
+// Runtime tuning. ma_ctl reads a setting into *oldp and/or writes *newp;
+// either may be NULL. Every value is a size_t (flags are 0 or 1), and a
+// write takes effect from the next operation that reads it, on any thread:
+//
+//   tcache.max              blocks cached per size class per thread (256)
+//   tcache.medium_bytes     bytes per medium-cache bin, 0 = off (65536)
+//   arena.count             arenas, one per NUMA node as read from /sys;
+//                           set it in MEMALLOC_CONF to simulate that many
+//                           nodes (1..16), read-only through ma_ctl
+//   arena.region_size       minimum new region, power of two (64MB)
+//   arena.huge_threshold    requests this large get their own mapping,
+//                           unmapped on free; 0 = off, else >= 128KB (0)
+//   arena.decay_ms          background purge decay (1000)
+//   slab.run_size           slab run size (read-only, 65536)
+//   background.enabled      start/stop the maintenance thread (0);
+//                           EPERM in an ENABLE_SINGLE_THREADED build
+//   background.interval_ms  time between passes (100)
+//   stats.enabled           slow-path event counters; ma_stats bytes are
+//                           always kept (1)
+//   thread.single           1 in an ENABLE_SINGLE_THREADED build, which
+//                           runs without locks for one allocating
+//                           thread (read-only)
+//   thread.node             the calling thread's arena, from the CPU it
+//                           first allocated on; writing moves the thread
+//                           and hands back the blocks it has cached
+//
+// Returns 0, ENOENT for an unknown name, EPERM when writing a read-only
+// setting, or EINVAL for an out-of-range value (nothing is written).
+//
+// MEMALLOC_CONF="name:value,..." applies the same settings at first use;
+// values are decimal with an optional k/m/g suffix, or true/false.
+// Invalid entries are reported on stderr and skipped.
+int ma_ctl(const char* name, size_t* oldp, const size_t* newp);
+
+// Reservation — pay for mapping and page faults up front, e.g. before a
+// latency-sensitive phase. ma_reserve maps bytes into each selected pool:
+// MA_RESERVE_ARENA adds an arena region (blocks over 512B), MA_RESERVE_RUNS
+// maps spare slab runs that later run refills take instead of calling mmap.
+// With neither flag, both pools. MA_RESERVE_POPULATE also faults the pages
+// in; with the background thread running, reserved arena pages left unused
+// for decay_ms are given back like any other free pages.
+// ma_thread_warmup fills the calling thread's cache with up to per_size
+// blocks of each size (up to 64KB), capped at the cache's own limit.
+// Return 0 on success; -1 if ma_reserve couldn't map the memory or a
+// warm-up size is 0 or over 64KB.
+#define MA_RESERVE_ARENA    0x1u
+#define MA_RESERVE_RUNS     0x2u
+#define MA_RESERVE_POPULATE 0x4u
+
+int ma_reserve(size_t bytes, unsigned flags);
+int ma_thread_warmup(const size_t* sizes, size_t count, unsigned per_size);
+
+// Heap inspection, for diagnosing fragmentation. Both calls go through
+// every slab run and arena region in address order. Threads keep running,
+// except that runs and huge blocks are not unmapped during the call, and
+// each region is locked while it is read.
+//
+// ma_heap_walk calls fn for every extent and stops at the first nonzero
+// return, which it returns (else 0). An arena region or huge block gives
+// one extent per block: its payload address and usable size, count 1. A
+// slab run gives at most two extents: count live blocks and count free
+// blocks of size bytes, addr being the run's first block. Blocks held in
+// thread caches count as live. fn must not call into the allocator.
+//
+// ma_heap_snapshot is the cheap form: one span per run or region with its
+// occupancy, written to spans[0..max). It returns how many spans there
+// were; call again with a larger array if that exceeds max. Run counts are
+// read without synchronizing with their owner threads, so they are a
+// near-instant view rather than an exact one.
+#define MA_TIER_SMALL  0   // size-class slab run (up to 512B)
+#define MA_TIER_ARENA  1   // block in a shared arena region
+#define MA_TIER_HUGE   2   // block with a mapping of its own
+#define MA_TIER_OBJECT 3   // object cache run
+
+typedef struct {
+    void*  addr;
+    size_t size;      // bytes per block
+    size_t count;     // blocks
+    int    tier;
+    int    in_use;
+} MA_HeapExtent;
+
+typedef int (*MA_HeapWalkFn)(const MA_HeapExtent* extent, void* arg);
+
+typedef struct {
+    void*    addr;          // run or region base
+    size_t   size;          // bytes mapped
+    int      tier;
+    uint32_t block_size;    // runs; 0 for regions
+    unsigned node;          // arena (NUMA node) its pages are bound to
+    size_t   live_bytes;
+    size_t   free_bytes;
+    size_t   largest_free;  // largest free block's usable size
+} MA_HeapSpan;
+
+int    ma_heap_walk(MA_HeapWalkFn fn, void* arg);
+size_t ma_heap_snapshot(MA_HeapSpan* spans, size_t max);
+
+// Deferred free for lock-free structures. Readers bracket each access to
+// shared nodes with ma_epoch_enter / ma_epoch_exit (nestable, per thread).
+// A writer that unlinks a node passes it to ma_free_deferred instead of
+// ma_free; it is left untouched until every thread that could still be
+// reading it has left its section, then freed into the cache of the thread
+// that reclaims it. Retired pointers are batched per thread (62 to a small
+// block, reused once empty) and reclaimed whenever a batch fills, or on
+// ma_epoch_reclaim, which returns the number freed by that call. Blocks
+// still waiting when their thread exits are freed by a later reclaim on
+// any thread.
+void   ma_epoch_enter(void);
+void   ma_epoch_exit(void);
+void   ma_free_deferred(void* ptr);
+size_t ma_epoch_reclaim(void);
+
+// Persistent heaps — allocations in a file mapped at a fixed address, so a
+// restarted process reattaches to its data (reachable from a root pointer
+// stored in the heap) and to the free space around it instead of rebuilding.
+// ma_pheap_open creates the file if it is missing or empty; base must be
+// 64KB-aligned and max_size bounds the file. When reopening, NULL and 0
+// take the values it was created with, and anything else must match them.
+// The whole [base, base + max_size) range must be unmapped. One process may
+// have a file open at a time (flock). Returns NULL with errno set on failure.
+//
+// If the last process to open the heap died without ma_pheap_close, open
+// rebuilds the allocator's metadata from what was committed and
+// ma_pheap_recovered returns 1. Allocations that had not been linked from
+// the root by then leak. Recovery covers the process dying, not the
+// machine: ma_pheap_sync (and close) write the file back for that.
+//
+// ma_free must not be given heap pointers, nor ma_pheap_free other memory.
+typedef struct MA_PHeap MA_PHeap;
+
+MA_PHeap* ma_pheap_open(const char* path, void* base, size_t max_size);
+void      ma_pheap_close(MA_PHeap* heap);
+int       ma_pheap_sync(MA_PHeap* heap);
+int       ma_pheap_recovered(const MA_PHeap* heap);
+void*     ma_pheap_alloc(MA_PHeap* heap, size_t size);
+void      ma_pheap_free(MA_PHeap* heap, void* ptr);
+void*     ma_pheap_root(MA_PHeap* heap);
+void      ma_pheap_set_root(MA_PHeap* heap, void* root);
+
+// Shared heaps — allocations in a memfd that several processes map, each
+// at its own address, for handing buffers between them without copying.
+// ma_shm_create makes a heap of size bytes (rounded down to 64KB; pages are
+// faulted in as used). Other processes map it with ma_shm_attach, given the
+// fd from ma_shm_fd (inherited across fork, or passed with SCM_RIGHTS).
+// Each handle counts as its own process: a forked child attaches instead
+// of using its parent's handle. Up to 64 handles at once; a slot left by a
+// process that died is reclaimed, with its blocks, on a later attach.
+// Returns NULL with errno set on failure: ENOTRECOVERABLE if a process
+// died inside the heap's lock and left it beyond repair, after which
+// allocations from that heap fail too.
+//
+// Pointers differ between processes: pass ma_shm_offset(ptr) and turn it
+// back with ma_shm_ptr(offset). Any handle can free any block. A block
+// allocated through another handle goes back to its owner without a lock.
+// Offset 0 is never a block, so ma_shm_offset returns 0 for NULL or a
+// pointer outside the heap, and ma_shm_ptr(0) returns NULL.
+//
+// ma_free must not be given heap pointers, nor ma_shm_free other memory.
+typedef struct MA_ShmHeap MA_ShmHeap;
+
+MA_ShmHeap* ma_shm_create(const char* name, size_t size);
+MA_ShmHeap* ma_shm_attach(int fd);
+void        ma_shm_detach(MA_ShmHeap* heap);
+int         ma_shm_fd(const MA_ShmHeap* heap);
+void*       ma_shm_alloc(MA_ShmHeap* heap, size_t size);
+void        ma_shm_free(MA_ShmHeap* heap, void* ptr);
+size_t      ma_shm_offset(const MA_ShmHeap* heap, const void* ptr);
+void*       ma_shm_ptr(const MA_ShmHeap* heap, size_t offset);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
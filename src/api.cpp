@@ -5,7 +5,15 @@
 #include "slab.h"
 #include "tls_cache.h"
 #include "stats.h"
+#include "pagemap.h"
+#include "trace.h"
+#include "background.h"
+#include "objcache.h"
+#include "config.h"
+#include "ctl.h"
+#include "numa.h"
 
+#include <cstdlib>
 #include <cstring>
 #include <mutex>
 #include <cstdint>
@@ -15,92 +23,337 @@ namespace ma {
 static std::once_flag g_init_flag;
 
 static void init() {
+    ma::ctl_load_env();
     ma::arena_init();
+
+#if MA_ENABLE_TRACE
+    if (const char* path = std::getenv("MEMALLOC_TRACE"))
+        ma::trace_start(path);
+#endif
 }
 
-} // namespace ma
+// untraced entry points — the public wrappers record one event per call,
+// so realloc's internal malloc + free don't show up twice
 
-extern "C" void* ma_malloc(size_t size) {
+static void* malloc_impl(size_t size) {
     if (size == 0) return nullptr;
-    std::call_once(ma::g_init_flag, ma::init);
+    std::call_once(g_init_flag, init);
 
-    ma::stats_add_requested(size);
+    stats_add_requested(size);
 
-    if (size <= ma::SMALL_MAX) {
-        void* ptr = ma::tls_alloc(size);
+    if (size <= SMALL_MAX) {
+        void* ptr = tls_alloc(size);
         if (ptr) {
-            ma::stats_add_allocated(
-                ma::class_to_size(ma::size_class(ma::round8(size))));
+            stats_add_allocated(class_to_size(size_class(round8(size))));
         }
         return ptr;
     }
 
-    void* p = ma::arena_alloc(size);
+    void* p = (size <= MEDIUM_MAX) ? tls_alloc_medium(size) : nullptr;
+    if (!p) p = arena_alloc(size);
     if (p) {
-        // allocated bytes are tracked by header size; approximate by request rounded
-        ma::stats_add_allocated(ma::round8(size));
+        // a cached or unsplit block can be larger than asked for — count
+        // its usable size so free subtracts the same amount
+        stats_add_allocated(payload_to_header(p)->size - BLOCK_OVERHEAD);
     }
     return p;
 }
 
-extern "C" void ma_free(void* ptr) {
+static void free_impl(void* ptr) {
     if (!ptr) return;
 
-    uintptr_t base = reinterpret_cast<uintptr_t>(ptr) & ~(ma::RUN_SIZE - 1);
-    ma::SlabRun* run = reinterpret_cast<ma::SlabRun*>(base);
+    // tier comes from the page map — never touches memory we don't own
+    uintptr_t entry = pagemap_get(ptr);
 
-    if (run->magic == ma::RUN_MAGIC) {
-        ma::stats_sub_allocated(ma::class_to_size(run->class_id));
-        ma::tls_free(ptr, run);
+    if (pagemap_kind(entry) == PAGE_RUN) {
+        SlabRun* run = pagemap_desc<SlabRun>(entry);
+        stats_sub_allocated(class_to_size(run->class_id));
+        tls_free(ptr, run);
         return;
     }
 
-    ma::BlockHeader* h = ma::payload_to_header(ptr);
-    if (h->magic == ma::BLOCK_MAGIC) {
-        // approximate allocated bytes decrease by payload
-        size_t payload = (h->size > ma::BLOCK_OVERHEAD) ? (h->size - ma::BLOCK_OVERHEAD) : 0;
-        if (payload) ma::stats_sub_allocated(payload);
-        ma::arena_free(ptr);
+    if (pagemap_kind(entry) == PAGE_REGION) {
+        BlockHeader* h = payload_to_header(ptr);
+        stats_sub_allocated(h->size - BLOCK_OVERHEAD);
+        if (!tls_free_medium(ptr)) arena_free(ptr);
+        return;
     }
-}
 
-extern "C" void* ma_calloc(size_t count, size_t size) {
-    size_t total = count * size;
-    void* ptr = ma_malloc(total);
-    if (ptr) std::memset(ptr, 0, total);
-    return ptr;
+    if (pagemap_kind(entry) == PAGE_OBJECT)
+        obj_cache_free_ptr(pagemap_desc<SlabRun>(entry), ptr);
 }
 
-extern "C" void* ma_realloc(void* ptr, size_t new_size) {
-    if (!ptr) return ma_malloc(new_size);
+static void* realloc_impl(void* ptr, size_t new_size) {
+    if (!ptr) return malloc_impl(new_size);
     if (!new_size) {
-        ma_free(ptr);
+        free_impl(ptr);
         return nullptr;
     }
 
-    uintptr_t base = reinterpret_cast<uintptr_t>(ptr) & ~(ma::RUN_SIZE - 1);
-    ma::SlabRun* run = reinterpret_cast<ma::SlabRun*>(base);
+    uintptr_t entry = pagemap_get(ptr);
 
     size_t old_size;
 
-    if (run->magic == ma::RUN_MAGIC) {
-        old_size = ma::class_to_size(run->class_id);
+    if (pagemap_kind(entry) == PAGE_RUN) {
+        SlabRun* run = pagemap_desc<SlabRun>(entry);
+        old_size = class_to_size(run->class_id);
 
-        if (new_size <= ma::SMALL_MAX &&
-            ma::size_class(ma::round8(new_size)) == run->class_id) {
+        if (new_size <= SMALL_MAX &&
+            size_class(round8(new_size)) == run->class_id) {
             return ptr;
         }
+    } else if (pagemap_kind(entry) == PAGE_REGION) {
+        BlockHeader* h = payload_to_header(ptr);
+        old_size = h->size - BLOCK_OVERHEAD;
+    } else if (pagemap_kind(entry) == PAGE_OBJECT) {
+        old_size = obj_cache_usable(pagemap_desc<SlabRun>(entry));
     } else {
-        ma::BlockHeader* h = ma::payload_to_header(ptr);
-        old_size = h->size - ma::BLOCK_OVERHEAD;
+        return nullptr;
     }
 
-    void* new_ptr = ma_malloc(new_size);
+    void* new_ptr = malloc_impl(new_size);
     if (!new_ptr) return nullptr;
 
     std::memcpy(new_ptr, ptr,
                 old_size < new_size ? old_size : new_size);
 
-    ma_free(ptr);
+    free_impl(ptr);
     return new_ptr;
-}
\ No newline at end of file
+}
+
+// ── extended API ──────────────────────────────────────────────────────────────
+
+struct XFlags {
+    size_t align;       // 0 unless over the natural 8
+    bool   zero;
+    bool   no_cache;
+    int    arena;       // explicit arena (its blocks for every size), or -1
+    bool   no_move;
+};
+
+static bool decode_flags(int flags, XFlags* f) {
+    std::call_once(g_init_flag, init);   // arena indices are checked against the topology
+
+    unsigned u  = static_cast<unsigned>(flags);
+    unsigned lg = u & MA_MALLOCX_LG_ALIGN_MASK;
+    if (lg >= 8 * sizeof(size_t) - 1) return false;
+
+    f->align    = lg > 3 ? size_t(1) << lg : 0;
+    f->zero     = u & MA_MALLOCX_ZERO;
+    f->no_cache = u & MA_MALLOCX_TCACHE_NONE;
+    f->no_move  = u & MA_MALLOCX_NO_MOVE;
+    f->arena    = int(u >> MA_MALLOCX_ARENA_SHIFT) - 1;
+    return f->arena < int(numa_node_count());
+}
+
+// usable bytes of a live block, 0 if it isn't ours
+static size_t usable_size(void* ptr) {
+    uintptr_t entry = pagemap_get(ptr);
+    switch (pagemap_kind(entry)) {
+    case PAGE_RUN:    return class_to_size(pagemap_desc<SlabRun>(entry)->class_id);
+    case PAGE_REGION: return payload_to_header(ptr)->size - BLOCK_OVERHEAD;
+    case PAGE_OBJECT: return obj_cache_usable(pagemap_desc<SlabRun>(entry));
+    default:          return 0;
+    }
+}
+
+// Slab blocks sit at 128 + i * block_size in a 64KB-aligned run, so for an
+// alignment up to 64, a class whose size is a multiple of it is aligned.
+static void* mallocx_impl(size_t size, const XFlags& f) {
+    if (size == 0) return nullptr;
+    std::call_once(g_init_flag, init);
+
+    stats_add_requested(size);
+
+    size_t small = f.align ? (size + f.align - 1) & ~(f.align - 1) : size;
+    void*  p     = nullptr;
+
+    if (f.arena < 0 && f.align <= CACHE_LINE && small <= SMALL_MAX) {
+        p = f.no_cache ? tls_alloc_uncached(small) : tls_alloc(small);
+        if (p) stats_add_allocated(class_to_size(size_class(round8(small))));
+    } else {
+        unsigned node = f.arena < 0 ? numa_thread_node() : unsigned(f.arena);
+        if (f.align) {
+            p = arena_alloc_aligned(size, f.align, node);
+        } else {
+            if (!f.no_cache && f.arena < 0 && size <= MEDIUM_MAX) p = tls_alloc_medium(size);
+            if (!p) p = arena_alloc(size, node);
+        }
+        if (p) stats_add_allocated(payload_to_header(p)->size - BLOCK_OVERHEAD);
+    }
+
+    if (p && f.zero) std::memset(p, 0, size);
+    return p;
+}
+
+static void dallocx_impl(void* ptr, const XFlags& f) {
+    if (!f.no_cache) return free_impl(ptr);
+
+    uintptr_t entry = pagemap_get(ptr);
+    if (pagemap_kind(entry) == PAGE_RUN) {
+        SlabRun* run = pagemap_desc<SlabRun>(entry);
+        stats_sub_allocated(class_to_size(run->class_id));
+        tls_free_uncached(ptr, run);
+    } else if (pagemap_kind(entry) == PAGE_REGION) {
+        stats_sub_allocated(payload_to_header(ptr)->size - BLOCK_OVERHEAD);
+        arena_free(ptr);
+    } else {
+        free_impl(ptr);
+    }
+}
+
+// true if ptr can hold size where it is (resizing an arena block to fit)
+static bool resize_in_place(void* ptr, size_t size, size_t old_size, const XFlags& f) {
+    if (f.align && reinterpret_cast<uintptr_t>(ptr) & (f.align - 1)) return false;
+
+    uintptr_t entry = pagemap_get(ptr);
+    switch (pagemap_kind(entry)) {
+    case PAGE_RUN:
+        // a smaller class moves unless the caller asked it not to
+        return size <= old_size &&
+               (f.no_move || size_class(round8(size)) == pagemap_desc<SlabRun>(entry)->class_id);
+    case PAGE_REGION:
+        if (!arena_resize(ptr, size)) return false;
+        stats_sub_allocated(old_size);
+        stats_add_allocated(payload_to_header(ptr)->size - BLOCK_OVERHEAD);
+        return true;
+    case PAGE_OBJECT:
+        return size <= old_size;
+    default:
+        return false;
+    }
+}
+
+static void* rallocx_impl(void* ptr, size_t size, const XFlags& f) {
+    if (!ptr) return mallocx_impl(size, f);
+    if (!size) return nullptr;
+
+    size_t old_size = usable_size(ptr);
+    if (!old_size) return nullptr;
+
+    if (resize_in_place(ptr, size, old_size, f)) {
+        if (f.zero && size > old_size)
+            std::memset(static_cast<char*>(ptr) + old_size, 0, size - old_size);
+        return ptr;
+    }
+    if (f.no_move) return nullptr;
+
+    void* new_ptr = mallocx_impl(size, f);
+    if (!new_ptr) return nullptr;
+
+    std::memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+    dallocx_impl(ptr, f);
+    return new_ptr;
+}
+
+} // namespace ma
+
+extern "C" void* ma_malloc(size_t size) {
+    void* p = ma::malloc_impl(size);
+    if (p) ma::trace_event(ma::TRACE_MALLOC, p, nullptr, size);
+    return p;
+}
+
+extern "C" void ma_free(void* ptr) {
+    if (!ptr) return;
+    // record before the block can be handed out again
+    ma::trace_event(ma::TRACE_FREE, ptr, nullptr, 0);
+    ma::free_impl(ptr);
+}
+
+extern "C" void* ma_calloc(size_t count, size_t size) {
+    size_t total = count * size;
+    void* ptr = ma_malloc(total);
+    if (ptr) std::memset(ptr, 0, total);
+    return ptr;
+}
+
+extern "C" void* ma_realloc(void* ptr, size_t new_size) {
+    // stamped before ptr can be freed and handed out again
+    uint64_t ts = ma::trace_stamp();
+    void*    p  = ma::realloc_impl(ptr, new_size);
+    ma::trace_event_at(ts, ma::TRACE_REALLOC, p, ptr, new_size);
+    return p;
+}
+
+extern "C" void* ma_mallocx(size_t size, int flags) {
+    ma::XFlags f;
+    if (!ma::decode_flags(flags, &f)) return nullptr;
+
+    void* p = ma::mallocx_impl(size, f);
+    if (p) ma::trace_event(ma::TRACE_MALLOC, p, nullptr, size);
+    return p;
+}
+
+extern "C" void* ma_rallocx(void* ptr, size_t size, int flags) {
+    ma::XFlags f;
+    if (!ma::decode_flags(flags, &f)) return nullptr;
+
+    uint64_t ts = ma::trace_stamp();
+    void*    p  = ma::rallocx_impl(ptr, size, f);
+    if (p) ma::trace_event_at(ts, ma::TRACE_REALLOC, p, ptr, size);
+    return p;
+}
+
+extern "C" void ma_dallocx(void* ptr, int flags) {
+    ma::XFlags f;
+    if (!ptr || !ma::decode_flags(flags, &f)) return;
+
+    ma::trace_event(ma::TRACE_FREE, ptr, nullptr, 0);
+    ma::dallocx_impl(ptr, f);
+}
+
+extern "C" int ma_trace_start(const char* path) {
+    return ma::trace_start(path) ? 0 : -1;
+}
+
+extern "C" void ma_trace_stop(void) {
+    ma::trace_stop();
+}
+
+extern "C" int ma_background_start(const MA_BackgroundConfig* config) {
+    std::call_once(ma::g_init_flag, ma::init);
+
+    ma::BackgroundConfig c{ma::g_config.interval_ms.load(std::memory_order_relaxed),
+                           ma::g_config.decay_ms.load(std::memory_order_relaxed)};
+    if (config) {
+        c.interval_ms = config->interval_ms;
+        c.decay_ms    = config->decay_ms;
+    }
+    return ma::background_start(c) ? 0 : -1;
+}
+
+extern "C" void ma_background_stop(void) {
+    ma::background_stop();
+}
+
+extern "C" int ma_ctl(const char* name, size_t* oldp, const size_t* newp) {
+    std::call_once(ma::g_init_flag, ma::init);
+    return ma::ctl(name, oldp, newp);
+}
+
+extern "C" int ma_reserve(size_t bytes, unsigned flags) {
+    std::call_once(ma::g_init_flag, ma::init);
+
+    if (!(flags & (MA_RESERVE_ARENA | MA_RESERVE_RUNS)))
+        flags |= MA_RESERVE_ARENA | MA_RESERVE_RUNS;
+    bool populate = flags & MA_RESERVE_POPULATE;
+
+    if ((flags & MA_RESERVE_ARENA) && !ma::arena_reserve(bytes, populate))
+        return -1;
+    if ((flags & MA_RESERVE_RUNS) &&
+        !ma::arena_reserve_runs((bytes + ma::RUN_SIZE - 1) / ma::RUN_SIZE, populate))
+        return -1;
+    return 0;
+}
+
+extern "C" int ma_thread_warmup(const size_t* sizes, size_t count, unsigned per_size) {
+    std::call_once(ma::g_init_flag, ma::init);
+
+    for (size_t i = 0; i < count; i++)
+        if (sizes[i] == 0 || sizes[i] > ma::MEDIUM_MAX) return -1;
+
+    // a short fill just means the cache was already full
+    for (size_t i = 0; i < count; i++) ma::tls_warmup(sizes[i], per_size);
+    return 0;
+}
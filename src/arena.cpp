@@ -1,200 +1,611 @@
 #include "arena.h"
 #include "internal.h"
 #include "platform.h"
+#include "pagemap.h"
 #include "stats.h"
+#include "config.h"
+#include "threading.h"
+#include "probes.h"
+#include "numa.h"
 
 #include <cstring>
 #include <mutex>
+#include <shared_mutex>
 #include <cassert>
 
 namespace ma {
 
-struct FreeNode {
-    FreeNode* prev;
-    FreeNode* next;
-};
+// ── block layer ───────────────────────────────────────────────────────────────
+// Shared with the persistent heap, whose ArenaState and regions live in its
+// file: only pointers into the arena's own memory, and every change lands
+// in an order a crash can stop at. The commit points are single stores:
+// a block's size (split, merge) and its in_use flag. Footers and the free
+// list are derived, and arena_rebuild recomputes them from the headers.
+
+size_t arena_block_size(size_t size) {
+    size_t needed = round8(size) + BLOCK_OVERHEAD;
+    return needed < MIN_BLOCK_SIZE ? MIN_BLOCK_SIZE : needed;
+}
+
+static void free_list_remove(ArenaState& a, FreeNode* node) {
+    if (node->prev) node->prev->next = node->next;
+    else            a.free_list      = node->next;
+    if (node->next) node->next->prev = node->prev;
+}
+
+static void free_list_insert(ArenaState& a, BlockHeader* h) {
+    FreeNode* node = reinterpret_cast<FreeNode*>(header_to_payload(h));
+    node->prev = nullptr;
+    node->next = a.free_list;
+    if (a.free_list) a.free_list->prev = node;
+    a.free_list = node;
+}
+
+ArenaRegion* region_format(void* mem, size_t size, bool purged, uint32_t tick) {
+    char*        base = static_cast<char*>(mem);
+    ArenaRegion* r    = reinterpret_cast<ArenaRegion*>(base);
+    r->start = base + sizeof(ArenaRegion);
+    r->end   = base + size;
+    r->next  = nullptr;
+    r->huge  = false;
+    r->node  = 0;
+
+    BlockHeader* h = reinterpret_cast<BlockHeader*>(r->start);
+    h->size       = r->end - r->start;
+    h->in_use     = false;
+    h->is_slab    = false;
+    h->purged     = purged;
+    h->freed_tick = tick;
+    h->magic      = BLOCK_MAGIC;
+    header_to_footer(h)->size = h->size;
+    return r;
+}
+
+void arena_link_region(ArenaState& a, ArenaRegion* r) {
+    r->next   = a.regions;
+    a.regions = r;
+    free_list_insert(a, reinterpret_cast<BlockHeader*>(r->start));
+}
+
+void* arena_take(ArenaState& a, size_t needed) {
+    for (FreeNode* node = a.free_list; node; node = node->next) {
+        BlockHeader* h = payload_to_header(node);
+        if (h->size < needed) continue;
+
+        free_list_remove(a, node);
+
+        if (h->size >= needed + MIN_BLOCK_SIZE) {
+            // remainder's tags first, so the shrink below is the commit
+            size_t       rem_size = h->size - needed;
+            BlockHeader* rem      = reinterpret_cast<BlockHeader*>(
+                reinterpret_cast<char*>(h) + needed);
+
+            rem->size       = rem_size;
+            rem->in_use     = false;
+            rem->is_slab    = false;
+            rem->purged     = h->purged;
+            rem->freed_tick = h->freed_tick;
+            rem->magic      = BLOCK_MAGIC;
+            header_to_footer(rem)->size = rem_size;
 
-struct ArenaRegion {
-    char*         start;
-    char*         end;
-    ArenaRegion*  next;
+            reinterpret_cast<BlockFooter*>(
+                reinterpret_cast<char*>(rem) - BLOCK_FOOTER_SIZE)->size = needed;
+            h->size = needed;
+
+            free_list_insert(a, rem);
+        }
+
+        h->in_use = true;
+        return header_to_payload(h);
+    }
+    return nullptr;
+}
+
+BlockHeader* arena_give(ArenaState& a, BlockHeader* h, ArenaRegion* region) {
+    h->in_use = false;
+
+    char* next_addr = reinterpret_cast<char*>(h) + h->size;
+
+    if (next_addr < region->end) {
+        BlockHeader* next = reinterpret_cast<BlockHeader*>(next_addr);
+        if (!next->in_use && next->magic == BLOCK_MAGIC) {
+            free_list_remove(a,
+                reinterpret_cast<FreeNode*>(header_to_payload(next)));
+
+            h->size += next->size;
+            header_to_footer(h)->size = h->size;
+        }
+    }
+
+    if (reinterpret_cast<char*>(h) > region->start) {
+        BlockFooter* prev_footer =
+            reinterpret_cast<BlockFooter*>(
+                reinterpret_cast<char*>(h) - BLOCK_FOOTER_SIZE);
+
+        BlockHeader* prev = footer_to_header(prev_footer);
+        if (!prev->in_use && prev->magic == BLOCK_MAGIC) {
+            free_list_remove(a,
+                reinterpret_cast<FreeNode*>(header_to_payload(prev)));
+
+            prev->size += h->size;
+            header_to_footer(prev)->size = prev->size;
+            h = prev;
+        }
+    }
+
+    // part of the block is freshly dirty — restart its decay
+    h->purged     = false;
+    h->freed_tick = a.purge_tick;
+    free_list_insert(a, h);
+    return h;
+}
+
+bool arena_rebuild(ArenaState& a) {
+    a.free_list = nullptr;
+
+    for (ArenaRegion* r = a.regions; r; r = r->next) {
+        BlockHeader* free_run = nullptr;   // the free block being extended
+
+        for (char* p = r->start; p < r->end;) {
+            BlockHeader* h = reinterpret_cast<BlockHeader*>(p);
+            if (h->magic != BLOCK_MAGIC || h->size < MIN_BLOCK_SIZE ||
+                h->size > size_t(r->end - p) || (h->size & 7))
+                return false;
+
+            p += h->size;
+
+            if (h->in_use) {
+                free_run = nullptr;
+                header_to_footer(h)->size = h->size;
+                continue;
+            }
+            if (free_run) {
+                free_run->size += h->size;   // a merge the crash cut short
+            } else {
+                free_run = h;
+                free_list_insert(a, h);
+            }
+            header_to_footer(free_run)->size = free_run->size;
+        }
+    }
+    return true;
+}
+
+// ── process arena ─────────────────────────────────────────────────────────────
+
+struct alignas(CACHE_LINE) NodeArena {
+    ArenaState arena;             // purge_tick is advanced by arena_purge
+    std::mutex lock;
+
+    // runs mapped ahead by arena_reserve_runs, linked through their first
+    // word; page-map leaves are in place but the entries stay PAGE_NONE
+    // until handed out
+    void*      spare_runs = nullptr;
+    std::mutex spare_lock;
 };
 
-static ArenaRegion* g_regions   = nullptr;
-static FreeNode*    g_free_list = nullptr;
-static std::mutex   g_arena_lock;
+static NodeArena g_nodes[NUMA_MAX_NODES];
+
+// unmappers share it, a heap walk holds it exclusively
+static std::shared_mutex g_unmap_lock;
+
+static std::shared_lock<std::shared_mutex> unmap_guard() {
+    if (single_threaded()) return std::shared_lock<std::shared_mutex>(g_unmap_lock, std::defer_lock);
+    return std::shared_lock<std::shared_mutex>(g_unmap_lock);
+}
 
-static ArenaRegion* new_region(size_t min_size) {
-    size_t sz = ARENA_REGION_SIZE;
+// caller holds node's lock
+static ArenaRegion* new_region(unsigned node, size_t min_size, bool populate = false) {
+    size_t sz = g_config.region_size.load(std::memory_order_relaxed);
     while (sz < min_size + BLOCK_OVERHEAD + sizeof(ArenaRegion))
         sz *= 2;
 
-    char* mem = static_cast<char*>(platform::vm_alloc(sz));
+    // RUN_SIZE-aligned so the region owns whole page-map chunks
+    char* mem = static_cast<char*>(platform::vm_alloc_aligned(sz, RUN_SIZE));
     if (!mem) return nullptr;
+    numa_bind(mem, sz, node);
+    if (populate) platform::vm_populate(mem, sz);
 
-    ArenaRegion* r = reinterpret_cast<ArenaRegion*>(mem);
-    r->start = mem + sizeof(ArenaRegion);
-    r->end   = mem + sz;
-    r->next  = nullptr;
-
-    size_t block_sz = r->end - r->start;
-
-    BlockHeader* h = reinterpret_cast<BlockHeader*>(r->start);
-    h->size    = block_sz;
-    h->in_use  = false;
-    h->is_slab = false;
-    h->magic   = BLOCK_MAGIC;
-
-    header_to_footer(h)->size = block_sz;
+    if (!pagemap_set(mem, sz, PAGE_REGION, mem)) {
+        platform::vm_free(mem, sz);
+        return nullptr;
+    }
 
-    FreeNode* node = reinterpret_cast<FreeNode*>(header_to_payload(h));
-    node->prev = nullptr;
-    node->next = g_free_list;
-    if (g_free_list) g_free_list->prev = node;
-    g_free_list = node;
+    stats_event(EV_REGION_MAPPED);
+    MA_PROBE2(region_map, mem, sz);
 
+    // fresh mapping: nothing resident unless populated
+    ArenaState&  a = g_nodes[node].arena;
+    ArenaRegion* r = region_format(mem, sz, !populate, a.purge_tick);
+    r->node = uint8_t(node);
+    arena_link_region(a, r);
     return r;
 }
 
+// lock-free: two loads through the page map
 static ArenaRegion* region_of(void* ptr) {
-    char* p = static_cast<char*>(ptr);
-    for (ArenaRegion* r = g_regions; r; r = r->next) {
-        if (p >= r->start && p < r->end)
-            return r;
+    uintptr_t e = pagemap_get(ptr);
+    if (pagemap_kind(e) != PAGE_REGION) return nullptr;
+    return pagemap_desc<ArenaRegion>(e);
+}
+
+// take node's arena lock, tagging the call if another thread held it;
+// nothing to take while single-threaded
+std::unique_lock<std::mutex> arena_lock(unsigned node) {
+    std::mutex& m = g_nodes[node].lock;
+    if (single_threaded()) return std::unique_lock<std::mutex>(m, std::defer_lock);
+
+    std::unique_lock<std::mutex> lock(m, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        stats_note_slow(SLOW_LOCK_WAIT);
+        uint64_t t0 = platform::monotonic_ns();
+        lock.lock();
+        uint64_t waited = platform::monotonic_ns() - t0;
+        stats_event(EV_LOCK_WAIT);
+        stats_event(EV_LOCK_WAIT_NS, waited);
+        MA_PROBE1(lock_wait, waited);
     }
-    return nullptr;
+    return lock;
 }
 
-static void free_list_remove(FreeNode* node) {
-    if (node->prev) node->prev->next = node->next;
-    else            g_free_list      = node->next;
-    if (node->next) node->next->prev = node->prev;
+void arena_init() {
+    numa_init();
+
+    unsigned node = numa_thread_node();
+    auto lock = lock_if_threaded(g_nodes[node].lock);
+    if (!g_nodes[node].arena.regions)
+        new_region(node, 0);
 }
 
-static void free_list_insert(BlockHeader* h) {
-    FreeNode* node = reinterpret_cast<FreeNode*>(header_to_payload(h));
-    node->prev = nullptr;
-    node->next = g_free_list;
-    if (g_free_list) g_free_list->prev = node;
-    g_free_list = node;
+// Above arena.huge_threshold a block gets a mapping of its own, rounded to
+// RUN_SIZE and unmapped as soon as it is freed, instead of being carved
+// from (and later pinning) a shared region. The lock is never taken.
+static void* huge_alloc(size_t needed, unsigned node) {
+    size_t sz  = (sizeof(ArenaRegion) + needed + RUN_SIZE - 1) & ~(RUN_SIZE - 1);
+    char*  mem = static_cast<char*>(platform::vm_alloc_aligned(sz, RUN_SIZE));
+    if (!mem) return nullptr;
+    numa_bind(mem, sz, node);
+
+    ArenaRegion* r = reinterpret_cast<ArenaRegion*>(mem);
+    r->start = mem + sizeof(ArenaRegion);
+    r->end   = mem + sz;
+    r->next  = nullptr;
+    r->huge  = true;
+    r->node  = uint8_t(node);
+
+    BlockHeader* h = reinterpret_cast<BlockHeader*>(r->start);
+    h->size       = r->end - r->start;
+    h->in_use     = true;
+    h->is_slab    = false;
+    h->purged     = false;
+    h->freed_tick = 0;
+    h->magic      = BLOCK_MAGIC;
+    header_to_footer(h)->size = h->size;
+
+    // published with its header in place, for heap walks
+    if (!pagemap_set(mem, sz, PAGE_REGION, mem)) {
+        platform::vm_free(mem, sz);
+        return nullptr;
+    }
+    stats_event(EV_REGION_MAPPED);
+    MA_PROBE2(region_map, mem, sz);
+    return header_to_payload(h);
 }
 
-void arena_init() {
-    std::lock_guard<std::mutex> lock(g_arena_lock);
-    if (!g_regions)
-        g_regions = new_region(ARENA_REGION_SIZE);
+static void huge_free(ArenaRegion* r) {
+    size_t sz = r->end - reinterpret_cast<char*>(r);
+    MA_PROBE2(region_unmap, r, sz);
+    auto guard = unmap_guard();
+    pagemap_clear(r, sz);
+    platform::vm_free(r, sz);
 }
 
 void* arena_alloc(size_t size) {
-    size = round8(size);
-    size_t needed = size + BLOCK_OVERHEAD;
-    if (needed < MIN_BLOCK_SIZE)
-        needed = MIN_BLOCK_SIZE;
+    return arena_alloc(size, numa_thread_node());
+}
+
+void* arena_alloc(size_t size, unsigned node) {
+    size_t needed = arena_block_size(size);
 
-    std::lock_guard<std::mutex> lock(g_arena_lock);
+    size_t huge = g_config.huge_threshold.load(std::memory_order_relaxed);
+    if (huge && round8(size) >= huge) return huge_alloc(needed, node);
+
+    auto lock = arena_lock(node);
 
     for (;;) {
-        for (FreeNode* node = g_free_list; node; node = node->next) {
-            BlockHeader* h = payload_to_header(node);
+        if (void* p = arena_take(g_nodes[node].arena, needed)) return p;
 
-            if (h->size >= needed) {
-                free_list_remove(node);
+        stats_note_slow(SLOW_NEW_REGION);
+        if (!new_region(node, needed)) return nullptr;
+    }
+}
 
-                if (h->size >= needed + MIN_BLOCK_SIZE) {
-                    size_t rem_size = h->size - needed;
+// cut h down to keep bytes; the tail becomes an in-use block of its own,
+// returned for the caller to give back
+static BlockHeader* split_tail(BlockHeader* h, size_t keep) {
+    BlockHeader* tail = reinterpret_cast<BlockHeader*>(reinterpret_cast<char*>(h) + keep);
+    tail->size       = h->size - keep;
+    tail->in_use     = true;
+    tail->is_slab    = false;
+    tail->purged     = h->purged;
+    tail->freed_tick = h->freed_tick;
+    tail->magic      = BLOCK_MAGIC;
+    header_to_footer(tail)->size = tail->size;
+
+    h->size = keep;
+    header_to_footer(h)->size = keep;
+    return tail;
+}
 
-                    h->size = needed;
-                    header_to_footer(h)->size = needed;
+void* arena_alloc_aligned(size_t size, size_t align, unsigned node) {
+    size_t needed = arena_block_size(size);
+    size_t slack  = align + MIN_BLOCK_SIZE;   // room for a free block in front
+    if (needed + slack < needed) return nullptr;
 
-                    BlockHeader* rem =
-                        reinterpret_cast<BlockHeader*>(
-                            reinterpret_cast<char*>(h) + needed);
+    ArenaState& a    = g_nodes[node].arena;
+    auto        lock = arena_lock(node);
 
-                    rem->size    = rem_size;
-                    rem->in_use  = false;
-                    rem->is_slab = false;
-                    rem->magic   = BLOCK_MAGIC;
-                    header_to_footer(rem)->size = rem_size;
+    void* p;
+    while (!(p = arena_take(a, needed + slack))) {
+        stats_note_slow(SLOW_NEW_REGION);
+        if (!new_region(node, needed + slack)) return nullptr;
+    }
 
-                    free_list_insert(rem);
-                }
+    BlockHeader* h      = payload_to_header(p);
+    ArenaRegion* region = region_of(h);
 
-                h->in_use = true;
-                return header_to_payload(h);
-            }
-        }
+    uintptr_t at = (reinterpret_cast<uintptr_t>(p) + align - 1) & ~(align - 1);
+    while (at != reinterpret_cast<uintptr_t>(p) && at - reinterpret_cast<uintptr_t>(p) < MIN_BLOCK_SIZE)
+        at += align;
+
+    if (size_t lead = at - reinterpret_cast<uintptr_t>(p)) {
+        BlockHeader* rest = split_tail(h, lead);
+        arena_give(a, h, region);
+        h = rest;
+    }
+    if (h->size >= needed + MIN_BLOCK_SIZE)
+        arena_give(a, split_tail(h, needed), region);
+
+    return header_to_payload(h);
+}
+
+bool arena_resize(void* ptr, size_t size) {
+    size_t       needed = arena_block_size(size);
+    BlockHeader* h      = payload_to_header(ptr);
+    ArenaRegion* region = region_of(h);
+    if (!region) return false;
+    if (region->huge) return needed <= h->size;   // the mapping stays as it is
+
+    ArenaState& a    = g_nodes[region->node].arena;
+    auto        lock = arena_lock(region->node);
+
+    if (needed > h->size) {
+        char* next_addr = reinterpret_cast<char*>(h) + h->size;
+        if (next_addr >= region->end) return false;
 
-        ArenaRegion* r = new_region(needed);
-        if (!r) return nullptr;
+        BlockHeader* next = reinterpret_cast<BlockHeader*>(next_addr);
+        if (next->in_use || next->magic != BLOCK_MAGIC || h->size + next->size < needed)
+            return false;
 
-        r->next = g_regions;
-        g_regions = r;
+        free_list_remove(a, reinterpret_cast<FreeNode*>(header_to_payload(next)));
+        h->size += next->size;
+        header_to_footer(h)->size = h->size;
     }
+    if (h->size >= needed + MIN_BLOCK_SIZE)
+        arena_give(a, split_tail(h, needed), region);
+    return true;
 }
 
 void arena_free(void* ptr) {
     if (!ptr) return;
 
     BlockHeader* h = payload_to_header(ptr);
-    std::lock_guard<std::mutex> lock(g_arena_lock);
-
-    h->in_use = false;
-
     ArenaRegion* region = region_of(h);
     if (!region) return;
+    if (region->huge) return huge_free(region);
 
-    char* next_addr = reinterpret_cast<char*>(h) + h->size;
-
-    if (next_addr < region->end) {
-        BlockHeader* next = reinterpret_cast<BlockHeader*>(next_addr);
-        if (!next->in_use && next->magic == BLOCK_MAGIC) {
-            free_list_remove(
-                reinterpret_cast<FreeNode*>(header_to_payload(next)));
+    auto lock = arena_lock(region->node);
+    arena_give(g_nodes[region->node].arena, h, region);
+}
 
-            h->size += next->size;
-            header_to_footer(h)->size = h->size;
+void arena_free_chain(void* head) {
+    // usually one node throughout; the lock changes hands when it doesn't
+    std::unique_lock<std::mutex> lock;
+    unsigned locked = NUMA_MAX_NODES;
+
+    while (head) {
+        void* next;
+        memcpy(&next, head, sizeof(void*));
+
+        BlockHeader* h = payload_to_header(head);
+        if (ArenaRegion* region = region_of(h)) {
+            if (region->node != locked) {
+                if (lock.owns_lock()) lock.unlock();
+                lock   = arena_lock(region->node);
+                locked = region->node;
+            }
+            arena_give(g_nodes[locked].arena, h, region);
         }
+        head = next;
     }
+}
 
-    if (reinterpret_cast<char*>(h) > region->start) {
-        BlockFooter* prev_footer =
-            reinterpret_cast<BlockFooter*>(
-                reinterpret_cast<char*>(h) - BLOCK_FOOTER_SIZE);
+// blocks taken off the free list per lock hold while purging
+static constexpr size_t PURGE_BATCH = 32;
 
-        BlockHeader* prev = footer_to_header(prev_footer);
-        if (!prev->in_use && prev->magic == BLOCK_MAGIC) {
-            free_list_remove(
-                reinterpret_cast<FreeNode*>(header_to_payload(prev)));
+// the pages of a free block that can go: all but the header, free-list
+// links and footer
+static void purge_range(BlockHeader* h, uintptr_t* lo, uintptr_t* hi) {
+    size_t page = platform::page_size();
+    *lo = (reinterpret_cast<uintptr_t>(header_to_payload(h)) + sizeof(FreeNode) + page - 1) &
+          ~(page - 1);
+    *hi = reinterpret_cast<uintptr_t>(header_to_footer(h)) & ~(page - 1);
+}
 
-            prev->size += h->size;
-            header_to_footer(prev)->size = prev->size;
-            h = prev;
+// Decayed blocks leave the free list, marked in use so neither an
+// allocation nor a neighbour's merge can touch them, and are purged with
+// the lock dropped. Given back, a block that merged with nothing keeps
+// purged; one that merged is partly dirty and decays again.
+static size_t purge_node(unsigned n, uint32_t decay_ticks) {
+    ArenaState& a      = g_nodes[n].arena;
+    size_t      purged = 0;
+    uint32_t    now;
+    {
+        auto lock = arena_lock(n);
+        now = ++a.purge_tick;
+    }
+
+    for (;;) {
+        BlockHeader* batch[PURGE_BATCH];
+        size_t       count = 0;
+        {
+            auto lock = arena_lock(n);
+            FreeNode* node = a.free_list;
+            while (node && count < PURGE_BATCH) {
+                FreeNode*    next = node->next;
+                BlockHeader* h    = payload_to_header(node);
+                // freed_tick == now: freed, or given back merged, during this
+                // pass; it waits for the next one
+                if (!h->purged && h->freed_tick != now &&
+                    now - h->freed_tick >= decay_ticks) {
+                    uintptr_t lo, hi;
+                    purge_range(h, &lo, &hi);
+                    if (hi > lo) {
+                        free_list_remove(a, node);
+                        h->in_use      = true;
+                        batch[count++] = h;
+                    } else {
+                        h->purged = true;   // nothing to give back
+                    }
+                }
+                node = next;
+            }
+        }
+        if (!count) break;
+
+        for (size_t i = 0; i < count; i++) {
+            uintptr_t lo, hi;
+            purge_range(batch[i], &lo, &hi);
+            platform::vm_purge(reinterpret_cast<void*>(lo), hi - lo);
+            purged += hi - lo;
         }
+
+        auto lock = arena_lock(n);
+        for (size_t i = 0; i < count; i++) {
+            BlockHeader* h    = batch[i];
+            size_t       size = h->size;
+            BlockHeader* m    = arena_give(a, h, region_of(h));
+            if (m == h && m->size == size) m->purged = true;
+        }
+        if (count < PURGE_BATCH) break;
     }
+    return purged;
+}
 
-    free_list_insert(h);
+size_t arena_purge(uint32_t decay_ticks) {
+    size_t purged = 0;
+    for (unsigned n = 0; n < numa_node_count(); n++)
+        purged += purge_node(n, decay_ticks);
+
+    if (purged) {
+        stats_event(EV_PURGED_BYTES, purged);
+        MA_PROBE1(purge, purged);
+    }
+    return purged;
 }
 
-void* arena_alloc_run() {
-    return platform::vm_alloc(RUN_SIZE);
+bool arena_reserve(size_t bytes, bool populate) {
+    unsigned node = numa_thread_node();
+    auto     lock = arena_lock(node);
+    return new_region(node, bytes, populate) != nullptr;
+}
+
+bool arena_reserve_runs(size_t count, bool populate) {
+    if (!count) return true;
+
+    unsigned   node = numa_thread_node();
+    NodeArena& n    = g_nodes[node];
+
+    size_t size = count * RUN_SIZE;
+    char*  mem  = static_cast<char*>(platform::vm_alloc_aligned(size, RUN_SIZE));
+    if (!mem) return false;
+    numa_bind(mem, size, node);
+    if (populate) platform::vm_populate(mem, size);
+
+    if (!pagemap_prepare(mem, size)) {
+        platform::vm_free(mem, size);
+        return false;
+    }
+    stats_event(EV_RUN_MAPPED, count);
+    MA_PROBE2(run_reserve, mem, count);
+
+    // each run is unmapped on its own later, which munmap allows
+    auto lock = lock_if_threaded(n.spare_lock);
+    for (size_t i = 0; i < count; i++) {
+        void* run = mem + i * RUN_SIZE;
+        memcpy(run, &n.spare_runs, sizeof(void*));
+        n.spare_runs = run;
+    }
+    return true;
+}
+
+static void* take_spare_run(NodeArena& n) {
+    auto lock = lock_if_threaded(n.spare_lock);
+    void* run = n.spare_runs;
+    if (run) memcpy(&n.spare_runs, run, sizeof(void*));
+    return run;
+}
+
+void* arena_alloc_run(PageKind kind) {
+    unsigned node = numa_thread_node();
+
+    // leaves were prepared when it was reserved, so this publishes only
+    if (void* mem = take_spare_run(g_nodes[node])) {
+        pagemap_set(mem, RUN_SIZE, kind, mem);
+        return mem;
+    }
+
+    // runs must be RUN_SIZE-aligned so slab_run_of can mask back to the header
+    void* mem = platform::vm_alloc_aligned(RUN_SIZE, RUN_SIZE);
+    if (!mem) return nullptr;
+    numa_bind(mem, RUN_SIZE, node);
+
+    if (!pagemap_set(mem, RUN_SIZE, kind, mem)) {
+        platform::vm_free(mem, RUN_SIZE);
+        return nullptr;
+    }
+    stats_event(EV_RUN_MAPPED);
+    MA_PROBE1(run_map, mem);
+    return mem;
 }
 
 void arena_free_run(void* run_base) {
+    stats_event(EV_RUN_UNMAPPED);
+    MA_PROBE1(run_unmap, run_base);
+    auto guard = unmap_guard();
+    pagemap_clear(run_base, RUN_SIZE);
     platform::vm_free(run_base, RUN_SIZE);
 }
 
-void arena_free_stats(size_t* free_bytes_out, size_t* largest_out) {
-    std::lock_guard<std::mutex> lock(g_arena_lock);
+std::unique_lock<std::shared_mutex> arena_hold_unmaps() {
+    if (single_threaded()) return std::unique_lock<std::shared_mutex>(g_unmap_lock, std::defer_lock);
+    return std::unique_lock<std::shared_mutex>(g_unmap_lock);
+}
 
+void arena_free_stats(size_t* free_bytes_out, size_t* largest_out) {
     size_t total = 0, largest = 0;
 
-    for (FreeNode* node = g_free_list; node; node = node->next) {
-        BlockHeader* h = payload_to_header(node);
-        size_t payload_sz = h->size - BLOCK_OVERHEAD;
+    for (unsigned n = 0; n < numa_node_count(); n++) {
+        auto lock = arena_lock(n);
 
-        total += payload_sz;
-        if (payload_sz > largest)
-            largest = payload_sz;
+        for (FreeNode* node = g_nodes[n].arena.free_list; node; node = node->next) {
+            BlockHeader* h = payload_to_header(node);
+            size_t payload_sz = h->size - BLOCK_OVERHEAD;
+
+            total += payload_sz;
+            if (payload_sz > largest)
+                largest = payload_sz;
+        }
     }
 
     *free_bytes_out = total;
@@ -1,16 +1,99 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+
+#include "pagemap.h"
 
 namespace ma {
 
+struct BlockHeader;
+
+// free blocks are linked through their payload
+struct FreeNode {
+    FreeNode* prev;
+    FreeNode* next;
+};
+
+struct ArenaRegion {
+    char*         start;
+    char*         end;
+    ArenaRegion*  next;
+    bool          huge;   // one block, mapped for it alone; not on the region list
+    uint8_t       node;   // process arena: the NUMA node it is bound to (numa.h)
+};
+
+// a set of regions and the free blocks in them: the process arena, or a
+// persistent heap's, which keeps its ArenaState inside the heap file
+struct ArenaState {
+    ArenaRegion* regions   = nullptr;
+    FreeNode*    free_list = nullptr;
+    uint32_t     purge_tick = 0;
+};
+
+// Block layer: first fit over an ArenaState, unlocked (callers serialize).
+// Only block headers are authoritative — a split or merge commits with one
+// size store, so a crash between any two stores leaves headers that
+// arena_rebuild can turn back into a consistent arena (footers and free
+// list recomputed, adjacent free blocks merged). False if a header is bad.
+size_t       arena_block_size(size_t size);   // payload size → block size
+ArenaRegion* region_format(void* mem, size_t size, bool purged, uint32_t tick);
+void         arena_link_region(ArenaState& a, ArenaRegion* r);
+void*        arena_take(ArenaState& a, size_t needed);
+BlockHeader* arena_give(ArenaState& a, BlockHeader* h, ArenaRegion* region);   // the merged block
+bool         arena_rebuild(ArenaState& a);
+
+// ── process arena ──
+// One per NUMA node, each with its own lock. Allocations come from the
+// calling thread's node unless one is given; a block is always freed to
+// the arena of the region it sits in.
+
 void  arena_init();
 void* arena_alloc(size_t size);
+void* arena_alloc(size_t size, unsigned node);
 void  arena_free(void* ptr);
 
-void* arena_alloc_run();
+// payload aligned to align (a power of two over 8), from a block taken
+// with slack for a free block in front of it; never from a huge mapping
+void* arena_alloc_aligned(size_t size, size_t align, unsigned node);
+
+// grow or shrink a live block in place: shrinking splits off the tail,
+// growing absorbs the free block after it. False (nothing changed) if the
+// block can't hold size where it is.
+bool  arena_resize(void* ptr, size_t size);
+
+// free a chain of payloads linked through their first word, taking the
+// lock once — used when a thread's medium cache flushes
+void  arena_free_chain(void* head);
+
+// RUN_SIZE-aligned run on the calling thread's node, registered in the
+// page map as kind
+void* arena_alloc_run(PageKind kind = PAGE_RUN);
 void  arena_free_run(void* run_base);
 
+// Reservation: map memory now so later allocations skip the syscalls, and
+// with populate, the first-touch page faults too. arena_reserve adds a
+// region with room for a bytes block. arena_reserve_runs maps count runs
+// into a spare pool that arena_alloc_run drains before mapping new ones;
+// runs freed later are unmapped as usual rather than refilling the pool.
+// Both reserve for the calling thread's node.
+bool  arena_reserve(size_t bytes, bool populate);
+bool  arena_reserve_runs(size_t count, bool populate);
+
 void  arena_free_stats(size_t* free_bytes_out, size_t* largest_out);
 
+// Heap walks (heapwalk.cpp). While arena_hold_unmaps is held no run or
+// region is unmapped, so every page-map entry points at mapped memory;
+// new ones still appear. Region blocks change only under their node's
+// arena_lock.
+std::unique_lock<std::mutex>        arena_lock(unsigned node);
+std::unique_lock<std::shared_mutex> arena_hold_unmaps();
+
+// background only: advance the purge tick and give back the pages of free
+// blocks that have sat unused for decay_ticks ticks. The madvise calls run
+// outside the arena lock. Returns bytes purged.
+size_t arena_purge(uint32_t decay_ticks);
+
 } // namespace ma
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include "background.h"
+#include "arena.h"
+#include "config.h"
+#include "stats.h"
+#include "threading.h"
+#include "tls_cache.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+namespace ma {
+
+static std::mutex              g_bg_lock;
+static std::condition_variable g_bg_cv;
+static std::thread             g_bg_thread;
+static bool                    g_bg_running = false;
+static bool                    g_bg_stop    = false;
+
+static void background_pass(uint32_t decay_ticks) {
+    arena_purge(decay_ticks);
+    tls_reclaim();
+    stats_fold_exited();
+}
+
+static void background_main() {
+    std::unique_lock<std::mutex> lock(g_bg_lock);
+    for (;;) {
+        uint32_t interval_ms = g_config.interval_ms.load(std::memory_order_relaxed);
+        uint32_t decay_ms    = g_config.decay_ms.load(std::memory_order_relaxed);
+        if (g_bg_cv.wait_for(lock, std::chrono::milliseconds(interval_ms),
+                             [] { return g_bg_stop; }))
+            break;
+
+        // decay is counted in passes; round up so nothing goes early
+        uint64_t decay_ticks = (uint64_t(decay_ms) + interval_ms - 1) / interval_ms;
+        lock.unlock();
+        background_pass(static_cast<uint32_t>(decay_ticks));
+        lock.lock();
+    }
+}
+
+bool background_start(const BackgroundConfig& config) {
+    // its passes would run unlocked alongside the allocating thread
+    if (single_threaded()) return false;
+
+    std::lock_guard<std::mutex> lock(g_bg_lock);
+    if (g_bg_running || config.interval_ms == 0) return false;
+
+    // a detached-at-exit thread would be torn down mid-pass
+    static bool exit_hook = (std::atexit(background_stop), true);
+    (void)exit_hook;
+
+    g_config.interval_ms.store(config.interval_ms, std::memory_order_relaxed);
+    g_config.decay_ms.store(config.decay_ms, std::memory_order_relaxed);
+
+    stats_defer_folds(true);
+    g_bg_stop    = false;
+    g_bg_running = true;
+    g_bg_thread  = std::thread(background_main);
+    return true;
+}
+
+void background_stop() {
+    {
+        std::lock_guard<std::mutex> lock(g_bg_lock);
+        if (!g_bg_running || g_bg_stop) return;
+        g_bg_stop = true;
+        g_bg_cv.notify_one();
+    }
+    g_bg_thread.join();
+
+    // threads that exited after the last pass
+    stats_defer_folds(false);
+    stats_fold_exited();
+
+    std::lock_guard<std::mutex> lock(g_bg_lock);
+    g_bg_running = false;
+    g_bg_stop    = false;
+}
+
+bool background_running() {
+    std::lock_guard<std::mutex> lock(g_bg_lock);
+    return g_bg_running;
+}
+
+} // namespace ma
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ma {
+
+// Optional maintenance thread (ma_background_start). Each pass:
+//   - purges arena free blocks that have been unused for decay_ms
+//   - drains retired and orphaned slab runs, unmapping those that emptied
+//   - folds the stat slots of threads that exited since the last pass
+// Foreground threads never run any of this. The config seeds
+// g_config.interval_ms / decay_ms, which each pass re-reads, so ma_ctl
+// changes apply from the next pass.
+
+struct BackgroundConfig {
+    uint32_t interval_ms;
+    uint32_t decay_ms;
+};
+
+bool background_start(const BackgroundConfig& config);
+void background_stop();
+bool background_running();
+
+} // namespace ma
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "internal.h"
+#include "../include/memalloc/fast.h"
+
+#include <atomic>
+
+namespace ma {
+
+// Runtime tunables, set through ma_ctl or MEMALLOC_CONF (ctl.cpp).
+// Readers do a relaxed load at each use and keep no copy, so a change
+// takes effect from the next operation that reads it, on every thread.
+// tcache.max is detail::tcache_max (memalloc/fast.h), which the inline
+// fast path reads too.
+struct Config {
+    std::atomic<size_t>   medium_bin_bytes{64 * 1024};        // 0 disables the medium cache
+    std::atomic<size_t>   region_size{ARENA_REGION_SIZE};     // minimum size of a new region
+    std::atomic<size_t>   huge_threshold{0};                  // 0: no dedicated mappings
+    std::atomic<uint32_t> decay_ms{1000};
+    std::atomic<uint32_t> interval_ms{100};
+    std::atomic<bool>     stats_events{true};
+};
+
+extern Config g_config;
+
+} // namespace ma
@@ -0,0 +1,191 @@
+#include "ctl.h"
+#include "config.h"
+#include "background.h"
+#include "threading.h"
+#include "numa.h"
+#include "tls_cache.h"
+#include "internal.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace ma {
+
+Config g_config;
+
+std::atomic<size_t> detail::tcache_max{TLS_MAX_LOCAL};
+
+// ── tunables ──────────────────────────────────────────────────────────────────
+
+static constexpr size_t TCACHE_MAX_LIMIT = 65536;
+static constexpr size_t HUGE_MIN         = 2 * MEDIUM_MAX;   // never medium-cacheable
+
+template <typename T>
+static size_t load(const std::atomic<T>& v) {
+    return static_cast<size_t>(v.load(std::memory_order_relaxed));
+}
+
+static int set_tcache_max(size_t v) {
+    if (v > TCACHE_MAX_LIMIT) return EINVAL;
+    detail::tcache_max.store(v, std::memory_order_relaxed);
+    return 0;
+}
+
+static int set_medium_bytes(size_t v) {
+    if (v > 16 * MEDIUM_MAX) return EINVAL;
+    g_config.medium_bin_bytes.store(v, std::memory_order_relaxed);
+    return 0;
+}
+
+static int set_region_size(size_t v) {
+    if (v < RUN_SIZE || !is_power_of_two(v)) return EINVAL;
+    g_config.region_size.store(v, std::memory_order_relaxed);
+    return 0;
+}
+
+static int set_huge_threshold(size_t v) {
+    if (v && v < HUGE_MIN) return EINVAL;
+    g_config.huge_threshold.store(v, std::memory_order_relaxed);
+    return 0;
+}
+
+static int set_decay_ms(size_t v) {
+    if (v > UINT32_MAX) return EINVAL;
+    g_config.decay_ms.store(static_cast<uint32_t>(v), std::memory_order_relaxed);
+    return 0;
+}
+
+static int set_interval_ms(size_t v) {
+    if (v == 0 || v > UINT32_MAX) return EINVAL;
+    g_config.interval_ms.store(static_cast<uint32_t>(v), std::memory_order_relaxed);
+    return 0;
+}
+
+static int set_stats_events(size_t v) {
+    if (v > 1) return EINVAL;
+    g_config.stats_events.store(v != 0, std::memory_order_relaxed);
+    return 0;
+}
+
+static int set_background(size_t v) {
+    if (v > 1) return EINVAL;
+    if (v && single_threaded()) return EPERM;
+    if (v) {
+        // already running is fine
+        background_start({g_config.interval_ms.load(std::memory_order_relaxed),
+                          g_config.decay_ms.load(std::memory_order_relaxed)});
+    } else {
+        background_stop();
+    }
+    return 0;
+}
+
+// simulated nodes, before the arenas exist: MEMALLOC_CONF only, since
+// ma_ctl initializes the heap first
+static int set_arena_count(size_t v) {
+    if (v < 1 || v > NUMA_MAX_NODES) return EINVAL;
+    return numa_simulate(static_cast<unsigned>(v)) ? 0 : EPERM;
+}
+
+// move the calling thread, handing back what it holds from the old node
+static int set_thread_node(size_t v) {
+    if (v >= numa_node_count()) return EINVAL;
+    if (v != numa_thread_node()) {
+        numa_set_thread_node(static_cast<unsigned>(v));
+        tls_flush();
+    }
+    return 0;
+}
+
+struct CtlEntry {
+    const char* name;
+    size_t (*get)();
+    int    (*set)(size_t);   // nullptr: read-only
+};
+
+static const CtlEntry g_ctl[] = {
+    {"tcache.max",           [] { return load(detail::tcache_max); },       set_tcache_max},
+    {"tcache.medium_bytes",  [] { return load(g_config.medium_bin_bytes); }, set_medium_bytes},
+    {"arena.count",          [] { return size_t(numa_node_count()); },       set_arena_count},
+    {"arena.region_size",    [] { return load(g_config.region_size); },      set_region_size},
+    {"arena.huge_threshold", [] { return load(g_config.huge_threshold); },   set_huge_threshold},
+    {"arena.decay_ms",       [] { return load(g_config.decay_ms); },         set_decay_ms},
+    {"slab.run_size",        [] { return RUN_SIZE; },                        nullptr},
+    {"background.enabled",   [] { return size_t(background_running()); },   set_background},
+    {"background.interval_ms", [] { return load(g_config.interval_ms); },    set_interval_ms},
+    {"thread.single",        [] { return size_t(single_threaded()); },       nullptr},
+    {"thread.node",          [] { return size_t(numa_thread_node()); },      set_thread_node},
+    {"stats.enabled",        [] { return load(g_config.stats_events); },     set_stats_events},
+};
+
+static const CtlEntry* find(const char* name, size_t len) {
+    for (const CtlEntry& e : g_ctl)
+        if (strlen(e.name) == len && !memcmp(e.name, name, len)) return &e;
+    return nullptr;
+}
+
+int ctl(const char* name, size_t* oldp, const size_t* newp) {
+    const CtlEntry* e = name ? find(name, strlen(name)) : nullptr;
+    if (!e) return ENOENT;
+    if (newp && !e->set) return EPERM;
+
+    if (oldp) *oldp = e->get();
+    return newp ? e->set(*newp) : 0;
+}
+
+// ── MEMALLOC_CONF ─────────────────────────────────────────────────────────────
+
+// decimal with an optional k/m/g suffix, or true/false
+static bool parse_value(const char* s, size_t len, size_t* out) {
+    if (len == 4 && !memcmp(s, "true", 4))  { *out = 1; return true; }
+    if (len == 5 && !memcmp(s, "false", 5)) { *out = 0; return true; }
+
+    size_t v = 0, i = 0;
+    for (; i < len && s[i] >= '0' && s[i] <= '9'; i++) {
+        if (v > (SIZE_MAX - 9) / 10) return false;
+        v = v * 10 + size_t(s[i] - '0');
+    }
+    if (i == 0) return false;
+
+    int shift = 0;
+    if (i < len) {
+        switch (s[i++]) {
+        case 'k': case 'K': shift = 10; break;
+        case 'm': case 'M': shift = 20; break;
+        case 'g': case 'G': shift = 30; break;
+        default: return false;
+        }
+    }
+    if (i != len || (shift && v > (SIZE_MAX >> shift))) return false;
+    *out = v << shift;
+    return true;
+}
+
+void ctl_load_env() {
+    const char* conf = std::getenv("MEMALLOC_CONF");
+    if (!conf) return;
+
+    for (const char* p = conf; *p;) {
+        const char* end = p + strcspn(p, ",");
+        const char* sep = static_cast<const char*>(memchr(p, ':', end - p));
+
+        const CtlEntry* e = sep ? find(p, sep - p) : nullptr;
+        size_t v = 0;
+        int    err;
+        if (!e)                                            err = ENOENT;
+        else if (!e->set)                                  err = EPERM;
+        else if (!parse_value(sep + 1, end - sep - 1, &v)) err = EINVAL;
+        else                                               err = e->set(v);
+
+        if (err)
+            fprintf(stderr, "memalloc: MEMALLOC_CONF: ignoring \"%.*s\": %s\n",
+                    int(end - p), p,
+                    err == ENOENT ? "unknown setting" :
+                    err == EPERM  ? "read-only" : "invalid value");
+        p = *end ? end + 1 : end;
+    }
+}
+
+} // namespace ma
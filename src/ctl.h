@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+
+namespace ma {
+
+// Read and/or write one tunable by name (see ma_ctl). Returns 0 or an
+// errno value: ENOENT unknown name, EPERM read-only, EINVAL out of range.
+int  ctl(const char* name, size_t* oldp, const size_t* newp);
+
+// Apply MEMALLOC_CONF="name:value,name:value". Bad entries are reported
+// on stderr and skipped. Called once from init.
+void ctl_load_env();
+
+} // namespace ma
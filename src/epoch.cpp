@@ -0,0 +1,255 @@
+#include "epoch.h"
+#include "tls_cache.h"
+#include "threading.h"
+#include "platform.h"
+#include "../include/memalloc/memalloc.h"
+
+#include <mutex>
+
+namespace ma {
+
+static std::atomic<uint64_t> g_epoch{1};
+
+// every EpochSlot ever handed out, newest chunk first
+static std::atomic<EpochSlot*> g_epoch_slots{nullptr};
+
+// critical sections of threads past their cache teardown (or without a
+// slot), which the registry scan can't see; while any is open the epoch
+// holds still
+static std::atomic<uint32_t> g_unregistered_active{0};
+
+// batches of exited threads, all counted as retired at the newest epoch
+// among them
+static std::mutex   g_epoch_orphans_lock;
+static RetireBatch* g_epoch_orphans       = nullptr;
+static uint64_t     g_epoch_orphans_epoch = 0;
+
+// free every block in a chain of batches; emptied batches go to e's spares
+// (up to EPOCH_SPARES) or are freed too
+static size_t free_batches(RetireBatch* b, EpochState* e) {
+    size_t n = 0;
+    while (b) {
+        RetireBatch* next = b->next;
+        for (size_t i = 0; i < b->count; i++) ma_free(b->blocks[i]);
+        n += b->count;
+
+        if (e && e->spare_count < EPOCH_SPARES) {
+            b->next  = e->spare;
+            e->spare = b;
+            e->spare_count++;
+        } else {
+            ma_free(b);
+        }
+        b = next;
+    }
+    return n;
+}
+
+static void orphans_add(RetireBatch* head, uint64_t epoch) {
+    RetireBatch* tail = head;
+    while (tail->next) tail = tail->next;
+
+    auto lock = lock_if_threaded(g_epoch_orphans_lock);
+    tail->next      = g_epoch_orphans;
+    g_epoch_orphans = head;
+    if (epoch > g_epoch_orphans_epoch) g_epoch_orphans_epoch = epoch;
+}
+
+static RetireBatch* batch_new(EpochState* e) {
+    RetireBatch* b;
+    if (e && e->spare) {
+        b        = e->spare;
+        e->spare = b->next;
+        e->spare_count--;
+    } else {
+        b = static_cast<RetireBatch*>(ma_malloc(sizeof(RetireBatch)));
+        if (!b) return nullptr;
+    }
+    b->next  = nullptr;
+    b->count = 0;
+    return b;
+}
+
+// ── participant registry ──────────────────────────────────────────────────────
+
+static EpochSlot* slot_claim() {
+    for (EpochSlot* s = g_epoch_slots.load(std::memory_order_acquire); s; s = s->next) {
+        uint32_t expected = 0;
+        if (!s->claimed.load(std::memory_order_relaxed) &&
+            s->claimed.compare_exchange_strong(expected, 1, std::memory_order_acquire,
+                                               std::memory_order_relaxed))
+            return s;
+    }
+
+    // fresh anonymous pages are zeroed: every slot is unclaimed and outside
+    size_t     chunk_sz = platform::page_size();
+    size_t     n        = chunk_sz / sizeof(EpochSlot);
+    EpochSlot* chunk    = static_cast<EpochSlot*>(platform::vm_alloc(chunk_sz));
+    if (!chunk) return nullptr;
+
+    chunk[0].claimed.store(1, std::memory_order_relaxed);
+    for (size_t i = 0; i + 1 < n; i++)
+        chunk[i].next = &chunk[i + 1];
+
+    EpochSlot* head = g_epoch_slots.load(std::memory_order_relaxed);
+    do {
+        chunk[n - 1].next = head;
+    } while (!g_epoch_slots.compare_exchange_weak(head, chunk, std::memory_order_release,
+                                                  std::memory_order_relaxed));
+    return &chunk[0];
+}
+
+// every participating thread is outside a section or has seen epoch
+static bool epoch_reached(uint64_t epoch) {
+    for (EpochSlot* s = g_epoch_slots.load(std::memory_order_acquire); s; s = s->next) {
+        uint64_t seen = s->local.load(std::memory_order_acquire);
+        if (seen && seen != epoch) return false;
+    }
+    return true;
+}
+
+// advance the epoch if every thread has caught up with it; returns the
+// epoch as it stands afterwards
+static uint64_t try_advance() {
+    uint64_t now = g_epoch.load(std::memory_order_acquire);
+    // order the registry scan after the caller's unlinks and retires
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (g_unregistered_active.load(std::memory_order_acquire) || !epoch_reached(now))
+        return now;
+
+    g_epoch.compare_exchange_strong(now, now + 1, std::memory_order_acq_rel);
+    return g_epoch.load(std::memory_order_acquire);
+}
+
+static size_t reclaim(EpochState* e, uint64_t now) {
+    size_t freed = 0;
+    if (e) {
+        for (size_t b = 0; b < EPOCH_BUCKETS; b++) {
+            if (!e->retired[b] || e->retired_epoch[b] + 2 > now) continue;
+            RetireBatch* chain = e->retired[b];
+            e->retired[b] = nullptr;
+            freed += free_batches(chain, e);
+        }
+    }
+
+    RetireBatch* orphans = nullptr;
+    {
+        auto lock = lock_if_threaded(g_epoch_orphans_lock);
+        if (g_epoch_orphans && g_epoch_orphans_epoch + 2 <= now) {
+            orphans         = g_epoch_orphans;
+            g_epoch_orphans = nullptr;
+        }
+    }
+    return freed + free_batches(orphans, e);
+}
+
+// the bucket for retires at now; what it held is from three epochs back
+// at least, which nobody can still be reading
+static size_t bucket_for(EpochState& e, uint64_t now) {
+    size_t k = now % EPOCH_BUCKETS;
+    if (e.retired[k] && e.retired_epoch[k] != now) {
+        RetireBatch* chain = e.retired[k];
+        e.retired[k] = nullptr;
+        free_batches(chain, &e);
+    }
+    return k;
+}
+
+void epoch_thread_exit(EpochState& e) {
+    // still inside (exiting from a later thread_local destructor): keep
+    // the epoch held, which the matching ma_epoch_exit calls release
+    if (e.nest) g_unregistered_active.fetch_add(e.nest, std::memory_order_seq_cst);
+
+    for (size_t b = 0; b < EPOCH_BUCKETS; b++) {
+        if (e.retired[b]) orphans_add(e.retired[b], e.retired_epoch[b]);
+        e.retired[b] = nullptr;
+    }
+    while (RetireBatch* b = e.spare) {
+        e.spare = b->next;
+        ma_free(b);
+    }
+    e.spare_count = 0;
+
+    if (EpochSlot* s = e.slot) {
+        e.slot = nullptr;
+        s->local.store(0, std::memory_order_release);
+        s->claimed.store(0, std::memory_order_release);
+    }
+}
+
+} // namespace ma
+
+extern "C" void ma_epoch_enter(void) {
+    using namespace ma;
+    if (tls_thread_exited()) {
+        g_unregistered_active.fetch_add(1, std::memory_order_seq_cst);
+        return;
+    }
+    EpochState& e = tls_get()->epoch;
+    if (e.nest++) return;
+
+    if (!e.slot && !(e.slot = slot_claim())) {
+        // out of memory: hold the epoch still for good, so deferred frees
+        // leak rather than being freed under this reader
+        e.nest--;
+        g_unregistered_active.fetch_add(1, std::memory_order_seq_cst);
+        return;
+    }
+    e.slot->local.store(g_epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+    // publish before any shared pointer is read: a reclaimer that misses
+    // the store can't have advanced past what those reads see
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+extern "C" void ma_epoch_exit(void) {
+    using namespace ma;
+    if (tls_thread_exited()) {
+        g_unregistered_active.fetch_sub(1, std::memory_order_release);
+        return;
+    }
+    EpochState& e = tls_get()->epoch;
+    if (e.nest && --e.nest == 0) e.slot->local.store(0, std::memory_order_release);
+}
+
+extern "C" void ma_free_deferred(void* ptr) {
+    using namespace ma;
+    if (!ptr) return;
+
+    // order the load after the caller's unlink store; otherwise a reader
+    // that entered at the next epoch could still find the block while it
+    // is tagged with this one, and the block would be freed under it
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t now = g_epoch.load(std::memory_order_acquire);
+    if (tls_thread_exited()) {
+        RetireBatch* b = batch_new(nullptr);
+        if (!b) return;
+        b->blocks[b->count++] = ptr;
+        orphans_add(b, now);
+        return;
+    }
+
+    EpochState&  e = tls_get()->epoch;
+    size_t       k = bucket_for(e, now);
+    RetireBatch* b = e.retired[k];
+    if (b && b->count == RETIRE_BATCH_SLOTS) {
+        // a batch filled up: a good moment to move the epoch along
+        reclaim(&e, try_advance());
+        now = g_epoch.load(std::memory_order_acquire);
+        k   = bucket_for(e, now);
+        b   = e.retired[k];
+    }
+    if (!b || b->count == RETIRE_BATCH_SLOTS) {
+        RetireBatch* fresh = batch_new(&e);
+        if (!fresh) return;   // out of memory: the block leaks rather than being freed early
+        fresh->next  = b;
+        e.retired[k] = b = fresh;
+    }
+    b->blocks[b->count++] = ptr;
+    e.retired_epoch[k] = now;
+}
+
+extern "C" size_t ma_epoch_reclaim(void) {
+    using namespace ma;
+    EpochState* e = tls_thread_exited() ? nullptr : &tls_get()->epoch;
+    return reclaim(e, try_advance());
+}
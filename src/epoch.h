@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace ma {
+
+// Epoch-based deferred free (ma_free_deferred). A global epoch counts up
+// from 1; a thread inside ma_epoch_enter/exit publishes the epoch it saw
+// at the outermost enter. The epoch advances only once every participating
+// thread is outside or has seen the current one, so a block retired at
+// epoch e can be read by nobody once the epoch reaches e + 2. Retired
+// pointers collect in per-thread batches, one chain per epoch mod 3, and go
+// back through ma_free — into the reclaiming thread's cache. The blocks
+// themselves are not written: a reader may still be following one.
+
+static constexpr size_t EPOCH_BUCKETS = 3;
+static constexpr size_t EPOCH_SPARES  = 4;   // emptied batches kept per thread
+
+// a small-class block of retired pointers
+struct RetireBatch {
+    RetireBatch* next;
+    size_t       count;
+    void*        blocks[(512 - 2 * sizeof(void*)) / sizeof(void*)];
+};
+
+static constexpr size_t RETIRE_BATCH_SLOTS = sizeof(RetireBatch::blocks) / sizeof(void*);
+
+// A thread's published epoch, in a registry of its own that reclaim scans
+// without a lock. Claimed at the thread's first ma_epoch_enter, so threads
+// that never enter aren't scanned; slots are never unmapped, and an exited
+// thread's slot goes to the next thread that enters.
+struct alignas(64) EpochSlot {
+    std::atomic<uint64_t> local;   // epoch seen at the outermost enter, 0 outside
+    std::atomic<uint32_t> claimed;
+    EpochSlot*            next;    // registry link, immutable once published
+};
+
+// per thread, inside TLSCache
+struct EpochState {
+    EpochSlot*            slot;    // null until the first enter
+    uint32_t              nest;
+    uint32_t              spare_count;
+    RetireBatch*          retired[EPOCH_BUCKETS];   // newest batch first
+    uint64_t              retired_epoch[EPOCH_BUCKETS];
+    RetireBatch*          spare;
+};
+
+// thread exit: batches still waiting move to a global list that the next
+// reclaim on any thread frees once the epoch allows
+void epoch_thread_exit(EpochState& e);
+
+} // namespace ma
@@ -0,0 +1,126 @@
+#include "arena.h"
+#include "pagemap.h"
+#include "internal.h"
+#include "../include/memalloc/memalloc.h"
+
+// ── Heap walks ────────────────────────────────────────────────────────────────
+// Everything mapped is in the page map, so both entry points scan it in
+// address order while holding off unmaps. Regions are walked block by
+// block along their boundary tags under the arena lock, one region at a
+// time. Runs are read without locks: geometry is fixed at carve time and
+// in_use is the owner's counter, read as it stands (blocks in a thread
+// cache count as live — the run handed them out). Object cache runs carve
+// on first use, so a run that isn't a slab run yet is skipped.
+
+namespace ma {
+
+static bool run_ready(SlabRun* run) {
+    return __atomic_load_n(&run->magic, __ATOMIC_ACQUIRE) == RUN_MAGIC;
+}
+
+static uint32_t run_in_use(SlabRun* run) {
+    return __atomic_load_n(&run->in_use, __ATOMIC_RELAXED);
+}
+
+static int run_tier(uintptr_t entry) {
+    return pagemap_kind(entry) == PAGE_OBJECT ? MA_TIER_OBJECT : MA_TIER_SMALL;
+}
+
+// blocks of a region in address order; fn(h) returning nonzero stops
+template <typename F>
+static int region_blocks(ArenaRegion* r, F&& fn) {
+    for (char* p = r->start; p < r->end;) {
+        BlockHeader* h = reinterpret_cast<BlockHeader*>(p);
+        if (h->magic != BLOCK_MAGIC || h->size < MIN_BLOCK_SIZE) break;
+        if (int rc = fn(h)) return rc;
+        p += h->size;
+    }
+    return 0;
+}
+
+} // namespace ma
+
+extern "C" int ma_heap_walk(MA_HeapWalkFn fn, void* arg) {
+    using namespace ma;
+    if (!fn) return 0;
+
+    auto hold = arena_hold_unmaps();
+    int  rc   = 0;
+
+    pagemap_for_each([&](uintptr_t entry) {
+        if (rc) return;
+
+        if (pagemap_kind(entry) == PAGE_REGION) {
+            ArenaRegion* r    = pagemap_desc<ArenaRegion>(entry);
+            int          tier = r->huge ? MA_TIER_HUGE : MA_TIER_ARENA;
+
+            auto lock = arena_lock(r->node);
+            rc = region_blocks(r, [&](BlockHeader* h) {
+                MA_HeapExtent x = {header_to_payload(h), h->size - BLOCK_OVERHEAD, 1,
+                                   tier, h->in_use ? 1 : 0};
+                return fn(&x, arg);
+            });
+            return;
+        }
+
+        SlabRun* run = pagemap_desc<SlabRun>(entry);
+        if (!run_ready(run)) return;
+
+        uint32_t used  = run_in_use(run);
+        char*    first = reinterpret_cast<char*>(run) + run->data_offset;
+        MA_HeapExtent live = {first, run->block_size, used, run_tier(entry), 1};
+        MA_HeapExtent free = {first, run->block_size, run->capacity - used, run_tier(entry), 0};
+
+        if (live.count && (rc = fn(&live, arg))) return;
+        if (free.count) rc = fn(&free, arg);
+    });
+    return rc;
+}
+
+extern "C" size_t ma_heap_snapshot(MA_HeapSpan* spans, size_t max) {
+    using namespace ma;
+
+    auto   hold  = arena_hold_unmaps();
+    size_t count = 0;
+
+    pagemap_for_each([&](uintptr_t entry) {
+        MA_HeapSpan s = {};
+
+        if (pagemap_kind(entry) == PAGE_REGION) {
+            ArenaRegion* r = pagemap_desc<ArenaRegion>(entry);
+            s.addr = r;
+            s.size = size_t(r->end - reinterpret_cast<char*>(r));
+            s.tier = r->huge ? MA_TIER_HUGE : MA_TIER_ARENA;
+            s.node = r->node;
+
+            auto lock = arena_lock(r->node);
+            region_blocks(r, [&](BlockHeader* h) {
+                size_t payload = h->size - BLOCK_OVERHEAD;
+                if (h->in_use) {
+                    s.live_bytes += payload;
+                } else {
+                    s.free_bytes += payload;
+                    if (payload > s.largest_free) s.largest_free = payload;
+                }
+                return 0;
+            });
+        } else {
+            SlabRun* run = pagemap_desc<SlabRun>(entry);
+            if (!run_ready(run)) return;
+
+            uint32_t used = run_in_use(run);
+            s.addr         = run;
+            s.size         = RUN_SIZE;
+            s.tier         = run_tier(entry);
+            s.block_size   = run->block_size;
+            s.node         = run->node;
+            s.live_bytes   = size_t(used) * run->block_size;
+            s.free_bytes   = size_t(run->capacity - used) * run->block_size;
+            s.largest_free = used < run->capacity ? run->block_size : 0;
+        }
+
+        if (count < max) spans[count] = s;
+        count++;
+    });
+    return count;
+}
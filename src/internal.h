@@ -13,8 +13,12 @@ static constexpr size_t   SIZE_CLASS_COUNT  = 64;
 static constexpr size_t   RUN_SIZE          = 65536;
 static constexpr size_t   ARENA_REGION_SIZE = 67108864;
 static constexpr size_t   TLS_MAX_LOCAL     = 256;
+static constexpr size_t   MEDIUM_MAX        = 65536;   // largest request the medium cache serves
 static constexpr uint64_t BLOCK_MAGIC       = 0xDEADC0DEDEADC0DEULL;
 static constexpr uint32_t RUN_MAGIC         = 0xA110CA7E;
+static constexpr uint32_t RUN_ORPHANED      = UINT32_MAX;   // owner_tid of a run whose thread exited
+static constexpr uint32_t OBJ_CLASS_BASE    = 1u << 16;     // class_id of object cache id i is base + i
+static constexpr size_t   OBJ_CACHE_MAX     = 128;          // live object caches at once
 
 // size class index for sizes 8..512 in steps of 8
 inline size_t size_class(size_t size) {
@@ -43,6 +47,8 @@ struct BlockHeader {
     size_t   size;       // includes header + footer, always multiple of 8
     bool     in_use;
     bool     is_slab;    // true if this block is backing a slab run
+    bool     purged;     // free, and its interior pages were handed back to the OS
+    uint32_t freed_tick; // arena purge tick when the block was last freed
     uint64_t magic;
 };
 
@@ -53,7 +59,8 @@ struct BlockFooter {
 static constexpr size_t BLOCK_HEADER_SIZE = sizeof(BlockHeader);
 static constexpr size_t BLOCK_FOOTER_SIZE = sizeof(BlockFooter);
 static constexpr size_t BLOCK_OVERHEAD    = BLOCK_HEADER_SIZE + BLOCK_FOOTER_SIZE;
-static constexpr size_t MIN_BLOCK_SIZE    = BLOCK_OVERHEAD + 8;
+// a free block keeps its prev/next free-list links in the payload
+static constexpr size_t MIN_BLOCK_SIZE    = BLOCK_OVERHEAD + 2 * sizeof(void*);
 
 inline BlockHeader* payload_to_header(void* payload) {
     return reinterpret_cast<BlockHeader*>(
@@ -74,6 +81,19 @@ inline BlockHeader* footer_to_header(BlockFooter* f) {
         reinterpret_cast<char*>(f) + BLOCK_FOOTER_SIZE - f->size);
 }
 
+// ── Medium cache bins ─────────────────────────────────────────────────────────
+// arena blocks with payload in [SMALL_MAX, 2 * MEDIUM_MAX), four bins per
+// power of two, keyed by the floor of the payload size
+
+static constexpr size_t MEDIUM_BINS_PER_POW2 = 4;
+static constexpr size_t MEDIUM_BIN_COUNT     = 8 * MEDIUM_BINS_PER_POW2;   // 2^9 .. 2^17
+
+inline size_t medium_bin(size_t payload) {
+    size_t e   = 63 - __builtin_clzll(payload);                    // 9..16
+    size_t sub = (payload >> (e - 2)) & (MEDIUM_BINS_PER_POW2 - 1);
+    return (e - 9) * MEDIUM_BINS_PER_POW2 + sub;
+}
+
 // ── Slab run header ───────────────────────────────────────────────────────────
 // sits at start of a RUN_SIZE-aligned block
 // owner thread uses local_free; other threads push to remote_free
@@ -84,9 +104,14 @@ struct alignas(CACHE_LINE) SlabRun {
     uint32_t              block_size;
     uint32_t              capacity;
     uint32_t              in_use;
-    uint32_t              owner_tid;
-    SlabRun*              next_run;
+    std::atomic<uint32_t> owner_tid;    // read by remote freers; RUN_ORPHANED once the owner exits
+    SlabRun*              next_run;     // owner's retired-run ring, or the orphan ring
+    SlabRun*              prev_run;
     void*                 local_free;   // intrusive free list for owner thread
+    uint16_t              link_offset;  // where a free block keeps its next pointer
+    uint16_t              node;         // NUMA node of its pages; freers compare it with theirs
+    uint32_t              data_offset;  // first block, from the run base
+    void                (*obj_dtor)(void*);   // object caches: run on each block at unmap
 
     // remote_free on its own cache line so remote writers don't false-share
     // with owner's hot fields above
@@ -98,5 +123,7 @@ struct alignas(CACHE_LINE) SlabRun {
 
 static_assert(sizeof(SlabRun) <= 2 * CACHE_LINE,
               "SlabRun header too large");
+static_assert(offsetof(SlabRun, remote_free) == CACHE_LINE,
+              "owner fields must fit the first cache line");
 
 } // namespace ma
\ No newline at end of file
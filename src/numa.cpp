@@ -0,0 +1,119 @@
+#include "numa.h"
+#include "platform.h"
+#include "../include/memalloc/fast.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+
+namespace ma {
+
+constinit thread_local uint32_t tl_numa_node = NUMA_NODE_UNSET;
+
+// fixed by numa_init, which runs under the init once-flag; read-only after
+static unsigned g_node_count = 1;
+static unsigned g_simulated  = 0;
+static bool     g_numa_ready = false;
+
+// real node id each arena's memory is bound to
+static unsigned g_bind_id[NUMA_MAX_NODES];
+
+// CPU → node; CPUs past the table fall back to cpu % count
+static constexpr unsigned CPU_TABLE = 1024;
+static uint8_t            g_cpu_node[CPU_TABLE];
+
+// read a small sysfs file into buf, NUL-terminated; false if it isn't there
+static bool read_sys(const char* path, char* buf, size_t cap) {
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    ssize_t n = ::read(fd, buf, cap - 1);
+    ::close(fd);
+    if (n <= 0) return false;
+    buf[n] = '\0';
+    return true;
+}
+
+// "0-3,8,10-11": fn(lo, hi) per range
+template <typename F>
+static void for_each_range(const char* s, F&& fn) {
+    while (*s >= '0' && *s <= '9') {
+        unsigned lo = 0, hi;
+        while (*s >= '0' && *s <= '9') lo = lo * 10 + unsigned(*s++ - '0');
+        hi = lo;
+        if (*s == '-') {
+            s++;
+            hi = 0;
+            while (*s >= '0' && *s <= '9') hi = hi * 10 + unsigned(*s++ - '0');
+        }
+        fn(lo, hi);
+        if (*s == ',') s++;
+    }
+}
+
+void numa_init() {
+    unsigned ids[NUMA_MAX_NODES];
+    unsigned real = 0;
+    char     buf[4096];
+
+    if (read_sys("/sys/devices/system/node/online", buf, sizeof(buf))) {
+        for_each_range(buf, [&](unsigned lo, unsigned hi) {
+            for (unsigned id = lo; id <= hi && real < NUMA_MAX_NODES; id++) ids[real++] = id;
+        });
+    }
+    if (!real) ids[real++] = 0;
+
+    if (g_simulated) {
+        long cpus = ::sysconf(_SC_NPROCESSORS_CONF);
+        if (cpus < 1) cpus = 1;
+        for (unsigned c = 0; c < CPU_TABLE; c++)
+            g_cpu_node[c] = uint8_t(c < unsigned(cpus) ? c * g_simulated / unsigned(cpus)
+                                                       : c % g_simulated);
+        for (unsigned i = 0; i < g_simulated; i++) g_bind_id[i] = ids[i % real];
+        g_node_count = g_simulated;
+    } else {
+        for (unsigned i = 0; i < real; i++) {
+            g_bind_id[i] = ids[i];
+            char path[64];
+            snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", ids[i]);
+            if (!read_sys(path, buf, sizeof(buf))) continue;
+            for_each_range(buf, [&](unsigned lo, unsigned hi) {
+                for (unsigned c = lo; c <= hi && c < CPU_TABLE; c++) g_cpu_node[c] = uint8_t(i);
+            });
+        }
+        g_node_count = real;
+    }
+    g_numa_ready = true;
+}
+
+unsigned numa_node_count() {
+    return g_node_count;
+}
+
+bool numa_simulate(unsigned count) {
+    if (g_numa_ready || count < 1 || count > NUMA_MAX_NODES) return false;
+    g_simulated = count;
+    return true;
+}
+
+unsigned numa_assign_thread() {
+    unsigned node = 0;
+    if (g_node_count > 1) {
+        int cpu = platform::current_cpu();
+        if (cpu >= 0)
+            node = unsigned(cpu) < CPU_TABLE ? g_cpu_node[cpu] : unsigned(cpu) % g_node_count;
+    }
+    tl_numa_node         = node;
+    detail::tl_fast.node = node;
+    return node;
+}
+
+void numa_set_thread_node(unsigned node) {
+    tl_numa_node         = node;
+    detail::tl_fast.node = node;
+}
+
+void numa_bind(void* mem, size_t size, unsigned node) {
+    if (g_node_count > 1) platform::vm_bind_node(mem, size, g_bind_id[node]);
+}
+
+} // namespace ma
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ma {
+
+// NUMA placement. There is one arena per node: its regions, its spare-run
+// pool and its lock. Each mapping gets bound to the node's memory before its
+// first touch. A thread takes the node of the CPU it first allocates on,
+// and keeps it until ma_ctl("thread.node") moves it. Frees route blocks
+// back to their own node: a foreign small block goes to its run's owner
+// rather than into this thread's cache, and a foreign arena block goes to
+// its own node's free list.
+//
+// The layout comes from /sys/devices/system/node at init. Setting
+// arena.count in MEMALLOC_CONF replaces it with that many nodes, each
+// taking an equal block of the CPUs. Simulated node i is bound to real
+// node i % real_nodes, so a single-node machine runs the same paths.
+
+static constexpr unsigned NUMA_MAX_NODES = 16;
+
+// at init, before the first arena is used
+void     numa_init();
+unsigned numa_node_count();
+
+// simulate count nodes (1..NUMA_MAX_NODES, checked by the caller); false
+// once numa_init has run
+bool     numa_simulate(unsigned count);
+
+// the calling thread's node, picked from its CPU on first call; inline
+// because every small free compares it with the run's
+static constexpr uint32_t NUMA_NODE_UNSET = UINT32_MAX;
+extern constinit thread_local uint32_t tl_numa_node;
+
+unsigned numa_assign_thread();
+
+inline unsigned numa_thread_node() {
+    uint32_t node = tl_numa_node;
+    return node != NUMA_NODE_UNSET ? node : numa_assign_thread();
+}
+
+void     numa_set_thread_node(unsigned node);
+
+// prefer node's memory for the not yet faulted pages of [mem, mem + size);
+// a no-op with a single node
+void     numa_bind(void* mem, size_t size, unsigned node);
+
+} // namespace ma
@@ -0,0 +1,92 @@
+#include "objcache.h"
+#include "slab.h"
+#include "tls_cache.h"
+#include "../include/memalloc/memalloc.h"
+
+#include <mutex>
+
+// ── Object caches ─────────────────────────────────────────────────────────────
+// Each cache owns dedicated runs (page kind PAGE_OBJECT) carved with its own
+// layout: the constructor runs once per object when a run is carved, and the
+// free-list link lives after the object, so a freed object stays constructed
+// and the next ma_cache_alloc hands it out as is. Destructors run when an
+// empty run is unmapped. Per-thread state reuses the size-class machinery
+// (PerClassCache, retired rings, orphaning on thread exit).
+//
+// Handles live in a fixed table. gen is odd while the cache is live and
+// bumped on destroy, so a thread still holding a slot for a destroyed cache
+// flushes it the next time that id is used.
+
+struct MA_Cache {
+    std::atomic<uint32_t> gen;
+    uint32_t              id;
+    size_t                obj_size;
+    ma::RunLayout         layout;
+};
+
+namespace ma {
+
+static MA_Cache   g_obj_caches[OBJ_CACHE_MAX];
+static std::mutex g_obj_caches_lock;   // create / destroy only
+
+static constexpr size_t OBJ_MAX_SIZE = RUN_SIZE / 8;
+
+void obj_cache_free_ptr(SlabRun* run, void* ptr) {
+    MA_Cache& c = g_obj_caches[run->class_id - OBJ_CLASS_BASE];
+    tls_obj_free(c.id, c.gen.load(std::memory_order_acquire), ptr);
+}
+
+size_t obj_cache_usable(SlabRun* run) {
+    return g_obj_caches[run->class_id - OBJ_CLASS_BASE].obj_size;
+}
+
+} // namespace ma
+
+extern "C" MA_Cache* ma_cache_create(size_t size, size_t align,
+                                     void (*ctor)(void*), void (*dtor)(void*)) {
+    using namespace ma;
+
+    if (align < sizeof(void*)) align = sizeof(void*);
+    if (size == 0 || !is_power_of_two(align) || align > RUN_SIZE / 16) return nullptr;
+
+    // link after the object, block rounded to the alignment
+    size_t link  = round8(size);
+    size_t block = (link + sizeof(void*) + align - 1) & ~(align - 1);
+    if (block > OBJ_MAX_SIZE) return nullptr;
+
+    std::lock_guard<std::mutex> lock(g_obj_caches_lock);
+    for (uint32_t id = 0; id < OBJ_CACHE_MAX; id++) {
+        MA_Cache& c = g_obj_caches[id];
+        uint32_t  g = c.gen.load(std::memory_order_relaxed);
+        if (g & 1) continue;
+
+        c.id       = id;
+        c.obj_size = size;
+        c.layout   = {OBJ_CLASS_BASE + id, static_cast<uint32_t>(block),
+                      static_cast<uint32_t>(align), static_cast<uint32_t>(link),
+                      ctor, dtor};
+        c.gen.store(g + 1, std::memory_order_release);
+        return &c;
+    }
+    return nullptr;
+}
+
+extern "C" void ma_cache_destroy(MA_Cache* cache) {
+    if (!cache) return;
+
+    // this thread's slot now; other threads' on their next use of the id or at exit
+    ma::tls_obj_flush(cache->id);
+
+    std::lock_guard<std::mutex> lock(ma::g_obj_caches_lock);
+    cache->gen.fetch_add(1, std::memory_order_release);
+}
+
+extern "C" void* ma_cache_alloc(MA_Cache* cache) {
+    return ma::tls_obj_alloc(cache->id, cache->gen.load(std::memory_order_acquire),
+                             cache->layout);
+}
+
+extern "C" void ma_cache_free(MA_Cache* cache, void* obj) {
+    if (!obj) return;
+    ma::tls_obj_free(cache->id, cache->gen.load(std::memory_order_acquire), obj);
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "internal.h"
+
+namespace ma {
+
+// ma_free / ma_realloc on an object cache pointer (PAGE_OBJECT) lands here
+void obj_cache_free_ptr(SlabRun* run, void* ptr);
+
+// object size usable through ma_realloc
+size_t obj_cache_usable(SlabRun* run);
+
+} // namespace ma
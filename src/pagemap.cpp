@@ -0,0 +1,74 @@
+#include "pagemap.h"
+#include "platform.h"
+
+namespace ma {
+
+// root lives in .bss — untouched slots cost no resident memory
+std::atomic<PageMapLeaf*> g_pagemap_root[size_t(1) << PAGEMAP_ROOT_BITS];
+
+static PageMapLeaf* leaf_for(uintptr_t key) {
+    std::atomic<PageMapLeaf*>& slot = g_pagemap_root[key >> PAGEMAP_LEAF_BITS];
+
+    PageMapLeaf* leaf = slot.load(std::memory_order_acquire);
+    if (leaf) return leaf;
+
+    // fresh anonymous pages are zeroed, i.e. every entry starts as PAGE_NONE
+    PageMapLeaf* fresh = static_cast<PageMapLeaf*>(
+        platform::vm_alloc(sizeof(PageMapLeaf)));
+    if (!fresh) return nullptr;
+
+    if (slot.compare_exchange_strong(leaf, fresh,
+                                     std::memory_order_acq_rel,
+                                     std::memory_order_acquire))
+        return fresh;
+
+    // another thread installed the leaf first
+    platform::vm_free(fresh, sizeof(PageMapLeaf));
+    return leaf;
+}
+
+static void store_range(void* base, size_t size, uintptr_t value) {
+    uintptr_t first = reinterpret_cast<uintptr_t>(base) >> PAGEMAP_SHIFT;
+    uintptr_t last  = (reinterpret_cast<uintptr_t>(base) + size - 1) >> PAGEMAP_SHIFT;
+
+    for (uintptr_t key = first; key <= last; key++) {
+        PageMapLeaf* leaf =
+            g_pagemap_root[key >> PAGEMAP_LEAF_BITS].load(std::memory_order_acquire);
+        leaf->entries[key & ((size_t(1) << PAGEMAP_LEAF_BITS) - 1)]
+            .store(value, std::memory_order_release);
+    }
+}
+
+static bool leaves_for(void* base, size_t size) {
+    uintptr_t first = reinterpret_cast<uintptr_t>(base) >> PAGEMAP_SHIFT;
+    uintptr_t last  = (reinterpret_cast<uintptr_t>(base) + size - 1) >> PAGEMAP_SHIFT;
+    if (last >> (PAGEMAP_ROOT_BITS + PAGEMAP_LEAF_BITS)) return false;
+
+    for (uintptr_t key = first; key <= last;
+         key = ((key >> PAGEMAP_LEAF_BITS) + 1) << PAGEMAP_LEAF_BITS) {
+        if (!leaf_for(key)) return false;
+    }
+    return true;
+}
+
+bool pagemap_set(void* base, size_t size, PageKind kind, void* desc) {
+    // make sure every leaf exists before publishing any entry
+    if (!leaves_for(base, size)) return false;
+
+    store_range(base, size, reinterpret_cast<uintptr_t>(desc) | kind);
+    return true;
+}
+
+bool pagemap_prepare(void* base, size_t size) {
+    if (!leaves_for(base, size)) return false;
+
+    // fault in the entries' pages now; they stay PAGE_NONE
+    store_range(base, size, 0);
+    return true;
+}
+
+void pagemap_clear(void* base, size_t size) {
+    store_range(base, size, 0);
+}
+
+} // namespace ma
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "internal.h"
+
+namespace ma {
+
+// ── Page map ──────────────────────────────────────────────────────────────────
+// two-level radix tree from address to the descriptor that owns it
+// granularity is RUN_SIZE: every run and arena region is RUN_SIZE-aligned,
+// so one 64KB chunk never straddles two owners
+//
+// entry = descriptor pointer | kind tag (descriptors are cache-line aligned)
+// readers take no lock: one load for the leaf, one for the entry
+
+enum PageKind : uintptr_t {
+    PAGE_NONE   = 0,
+    PAGE_RUN    = 1,   // descriptor is a SlabRun*
+    PAGE_REGION = 2,   // descriptor is an arena region header
+    PAGE_OBJECT = 3,   // descriptor is a SlabRun* owned by an object cache
+};
+
+static constexpr size_t    PAGEMAP_SHIFT     = 16;                 // log2(RUN_SIZE)
+static constexpr size_t    PAGEMAP_LEAF_BITS = 16;
+static constexpr size_t    PAGEMAP_ROOT_BITS = 48 - PAGEMAP_SHIFT - PAGEMAP_LEAF_BITS;
+static constexpr uintptr_t PAGEMAP_KIND_MASK = 3;
+
+static_assert((size_t(1) << PAGEMAP_SHIFT) == RUN_SIZE,
+              "page map granularity must match RUN_SIZE");
+
+struct PageMapLeaf {
+    std::atomic<uintptr_t> entries[size_t(1) << PAGEMAP_LEAF_BITS];
+};
+
+extern std::atomic<PageMapLeaf*> g_pagemap_root[size_t(1) << PAGEMAP_ROOT_BITS];
+
+inline uintptr_t pagemap_get(const void* p) {
+    uintptr_t key = reinterpret_cast<uintptr_t>(p) >> PAGEMAP_SHIFT;
+    if (key >> (PAGEMAP_ROOT_BITS + PAGEMAP_LEAF_BITS)) return 0;
+
+    PageMapLeaf* leaf =
+        g_pagemap_root[key >> PAGEMAP_LEAF_BITS].load(std::memory_order_acquire);
+    if (!leaf) return 0;
+
+    return leaf->entries[key & ((size_t(1) << PAGEMAP_LEAF_BITS) - 1)]
+        .load(std::memory_order_acquire);
+}
+
+inline PageKind pagemap_kind(uintptr_t entry) {
+    return static_cast<PageKind>(entry & PAGEMAP_KIND_MASK);
+}
+
+template <typename T>
+inline T* pagemap_desc(uintptr_t entry) {
+    return reinterpret_cast<T*>(entry & ~PAGEMAP_KIND_MASK);
+}
+
+// call fn(entry) for each distinct owner in address order — consecutive
+// chunks with the same entry are reported once. Lock-free; an owner mapped
+// or unmapped during the scan may or may not be seen.
+template <typename F>
+void pagemap_for_each(F&& fn) {
+    uintptr_t last = 0;
+    for (size_t i = 0; i < (size_t(1) << PAGEMAP_ROOT_BITS); i++) {
+        PageMapLeaf* leaf = g_pagemap_root[i].load(std::memory_order_acquire);
+        if (!leaf) continue;
+        for (auto& slot : leaf->entries) {
+            uintptr_t e = slot.load(std::memory_order_acquire);
+            if (e && e != last) fn(e);
+            last = e;
+        }
+    }
+}
+
+// map every chunk of [base, base + size) to desc — base and size RUN_SIZE-aligned
+// returns false if the range is outside the mapped address space or a leaf
+// could not be allocated
+bool pagemap_set(void* base, size_t size, PageKind kind, void* desc);
+
+// allocate and fault in the leaves covering [base, base + size) ahead of a
+// later pagemap_set, so that call makes no syscall and takes no page fault
+bool pagemap_prepare(void* base, size_t size);
+
+// unmap [base, base + size) — call before returning the memory to the OS
+void pagemap_clear(void* base, size_t size);
+
+} // namespace ma
@@ -0,0 +1,431 @@
+#include "arena.h"
+#include "internal.h"
+#include "threading.h"
+#include "../include/memalloc/memalloc.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <new>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ── Persistent heaps ──────────────────────────────────────────────────────────
+// A heap file mapped MAP_SHARED at the same base address every time, so the
+// allocator's metadata can hold plain pointers and a reopen reattaches to
+// it in place. The file is cut into RUN_SIZE chunks:
+//
+//   [PHeader + chunk map] [chunk] [chunk] ...            ← top, file grows here
+//
+// Each chunk is free, a bitmap run for one size class (≤512B), or part of
+// an arena region carved by the block layer in arena.cpp. Every change
+// commits with one store — a bitmap bit, a chunk map entry, a block's size
+// or in_use — so a process that dies mid-operation leaves the file in a
+// state recovery can repair. What recovery recomputes (region list, free
+// list, footers, run counts, partial lists, free chunk stack) is derived;
+// the bitmaps, chunk map and block headers are the truth.
+//
+// Consistency is per process crash: the page cache survives the process.
+// Only ma_pheap_sync and ma_pheap_close write it back for a power loss.
+
+namespace ma {
+
+static constexpr uint64_t PHEAP_MAGIC   = 0x5041454850414D4DULL;   // "MMAPHEAP"
+static constexpr uint32_t PHEAP_VERSION = 1;
+static constexpr size_t   PHEAP_GROW    = 16 * RUN_SIZE;   // minimum arena region
+
+// chunk map entry: kind in the low 2 bits; for arena chunks, the index of
+// the region's first chunk in the rest
+enum : uint32_t { CHUNK_FREE = 0, CHUNK_META = 1, CHUNK_RUN = 2, CHUNK_ARENA = 3 };
+
+static constexpr uint32_t chunk_entry(uint32_t kind, size_t head = 0) {
+    return static_cast<uint32_t>(head << 2) | kind;
+}
+
+// slab run in the heap: a used bit per block instead of a free list
+struct PRun {
+    uint32_t magic;
+    uint32_t class_id;
+    uint32_t block_size;
+    uint32_t capacity;
+    uint32_t in_use;     // derived: popcount of bitmap
+    uint32_t hint;       // derived: first bitmap word that may have a zero
+    PRun*    next;       // derived: partial list of the class
+    PRun*    prev;
+    uint64_t bitmap[RUN_SIZE / 8 / 64];
+};
+
+static constexpr size_t PRUN_DATA = (sizeof(PRun) + CACHE_LINE - 1) & ~(CACHE_LINE - 1);
+
+struct PHeader {
+    uint64_t   magic;
+    uint32_t   version;
+    uint32_t   dirty;          // set while open; still set at open = crashed
+    uintptr_t  base;
+    size_t     max_size;
+    size_t     top;            // bytes of chunks handed out, from base
+    size_t     meta_chunks;    // header + chunk map
+    void*      root;
+    ArenaState arena;          // derived
+    void*      free_chunks;    // derived: free chunks below top, linked through word 0
+    PRun*      partial[SIZE_CLASS_COUNT];   // derived
+    uint32_t   chunk_map[];
+};
+
+} // namespace ma
+
+struct MA_PHeap {
+    ma::PHeader* hdr;
+    int          fd;
+    size_t       mapped;       // bytes of file mapped from base
+    bool         recovered;
+    std::mutex   lock;
+};
+
+namespace ma {
+
+static char* chunk_addr(PHeader* h, size_t i) {
+    return reinterpret_cast<char*>(h) + i * RUN_SIZE;
+}
+
+static size_t chunk_index(PHeader* h, const void* p) {
+    return size_t(static_cast<const char*>(p) - reinterpret_cast<char*>(h)) / RUN_SIZE;
+}
+
+// make the file (and the mapping) cover bytes from base
+static bool ensure_mapped(MA_PHeap* ph, size_t bytes) {
+    if (bytes <= ph->mapped) return true;
+
+    size_t want = (bytes + PHEAP_GROW - 1) & ~(PHEAP_GROW - 1);
+    if (want > ph->hdr->max_size) want = ph->hdr->max_size;
+    if (bytes > want || ::ftruncate(ph->fd, static_cast<off_t>(want)) != 0) return false;
+
+    char* at = reinterpret_cast<char*>(ph->hdr) + ph->mapped;
+    void* p  = ::mmap(at, want - ph->mapped, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_FIXED, ph->fd, static_cast<off_t>(ph->mapped));
+    if (p == MAP_FAILED) return false;
+    ph->mapped = want;
+    return true;
+}
+
+// ── runs ──
+
+static void partial_push(PHeader* h, PRun* r) {
+    PRun*& head = h->partial[r->class_id];
+    r->prev = nullptr;
+    r->next = head;
+    if (head) head->prev = r;
+    head = r;
+}
+
+static void partial_remove(PHeader* h, PRun* r) {
+    if (r->prev) r->prev->next = r->next;
+    else         h->partial[r->class_id] = r->next;
+    if (r->next) r->next->prev = r->prev;
+}
+
+static void chunk_release(PHeader* h, size_t i) {
+    h->chunk_map[i] = chunk_entry(CHUNK_FREE);
+    *reinterpret_cast<void**>(chunk_addr(h, i)) = h->free_chunks;
+    h->free_chunks = chunk_addr(h, i);
+}
+
+static PRun* run_new(MA_PHeap* ph, uint32_t cls) {
+    PHeader* h = ph->hdr;
+    char*    mem;
+    if (h->free_chunks) {
+        mem = static_cast<char*>(h->free_chunks);
+        h->free_chunks = *reinterpret_cast<void**>(mem);
+    } else {
+        if (!ensure_mapped(ph, h->top + RUN_SIZE)) return nullptr;
+        mem = chunk_addr(h, h->top / RUN_SIZE);
+        h->chunk_map[h->top / RUN_SIZE] = chunk_entry(CHUNK_FREE);
+        h->top += RUN_SIZE;
+    }
+
+    PRun* r = reinterpret_cast<PRun*>(mem);
+    std::memset(r, 0, sizeof(PRun));
+    r->magic      = RUN_MAGIC;
+    r->class_id   = cls;
+    r->block_size = static_cast<uint32_t>(class_to_size(cls));
+    r->capacity   = static_cast<uint32_t>((RUN_SIZE - PRUN_DATA) / r->block_size);
+
+    h->chunk_map[chunk_index(h, mem)] = chunk_entry(CHUNK_RUN);   // commit
+    partial_push(h, r);
+    return r;
+}
+
+static void* run_alloc(MA_PHeap* ph, size_t size) {
+    PHeader* h   = ph->hdr;
+    uint32_t cls = static_cast<uint32_t>(size_class(size));
+
+    PRun* r = h->partial[cls];
+    if (!r && !(r = run_new(ph, cls))) return nullptr;
+
+    uint32_t w = r->hint;
+    while (~r->bitmap[w] == 0) w++;
+    uint32_t i = w * 64 + static_cast<uint32_t>(__builtin_ctzll(~r->bitmap[w]));
+
+    r->bitmap[w] |= uint64_t(1) << (i % 64);   // commit
+    r->hint = w;
+    if (++r->in_use == r->capacity) partial_remove(h, r);
+    return reinterpret_cast<char*>(r) + PRUN_DATA + size_t(i) * r->block_size;
+}
+
+static void run_free(PHeader* h, PRun* r, void* ptr) {
+    size_t off = size_t(static_cast<char*>(ptr) - reinterpret_cast<char*>(r));
+    if (off < PRUN_DATA || (off - PRUN_DATA) % r->block_size) return;
+
+    size_t   i   = (off - PRUN_DATA) / r->block_size;
+    uint64_t bit = uint64_t(1) << (i % 64);
+    if (i >= r->capacity || !(r->bitmap[i / 64] & bit)) return;
+
+    r->bitmap[i / 64] &= ~bit;   // commit
+    if (i / 64 < r->hint) r->hint = static_cast<uint32_t>(i / 64);
+
+    if (r->in_use-- == r->capacity) partial_push(h, r);
+    if (r->in_use == 0) {
+        partial_remove(h, r);
+        chunk_release(h, chunk_index(h, r));
+    }
+}
+
+// ── arena ──
+
+// a new region at top, big enough for a needed-byte block
+static bool region_grow(MA_PHeap* ph, size_t needed) {
+    PHeader* h  = ph->hdr;
+    size_t   sz = (sizeof(ArenaRegion) + needed + RUN_SIZE - 1) & ~(RUN_SIZE - 1);
+    if (sz < PHEAP_GROW) sz = PHEAP_GROW;
+    if (h->top + sz > h->max_size || !ensure_mapped(ph, h->top + sz)) return false;
+
+    size_t       first = h->top / RUN_SIZE;
+    ArenaRegion* r     = region_format(chunk_addr(h, first), sz, false, 0);
+    for (size_t i = first; i < first + sz / RUN_SIZE; i++)
+        h->chunk_map[i] = chunk_entry(CHUNK_ARENA, first);
+    h->top += sz;   // commit
+
+    arena_link_region(h->arena, r);
+    return true;
+}
+
+static ArenaRegion* region_at(PHeader* h, size_t chunk) {
+    return reinterpret_cast<ArenaRegion*>(chunk_addr(h, h->chunk_map[chunk] >> 2));
+}
+
+// ── open / recover ──
+
+// rebuild everything derived from the chunk map, bitmaps and block headers
+static bool recover(PHeader* h) {
+    h->arena.regions = nullptr;
+    h->free_chunks   = nullptr;
+    std::memset(h->partial, 0, sizeof(h->partial));
+
+    size_t top = h->top / RUN_SIZE;
+    for (size_t i = top; i-- > h->meta_chunks;) {
+        uint32_t e    = h->chunk_map[i];
+        char*    mem  = chunk_addr(h, i);
+
+        switch (e & 3) {
+        case CHUNK_ARENA: {
+            size_t first = e >> 2;
+            if (first != i) break;   // found once, at the region's first chunk
+
+            size_t end = i + 1;
+            while (end < top && h->chunk_map[end] == e) end++;
+
+            ArenaRegion* r = reinterpret_cast<ArenaRegion*>(mem);
+            r->start = mem + sizeof(ArenaRegion);
+            r->end   = chunk_addr(h, end);
+            r->huge  = false;
+            r->next  = h->arena.regions;
+            h->arena.regions = r;
+            break;
+        }
+        case CHUNK_RUN: {
+            PRun* r = reinterpret_cast<PRun*>(mem);
+            if (r->magic != RUN_MAGIC || r->class_id >= SIZE_CLASS_COUNT) return false;
+
+            r->in_use = 0;
+            r->hint   = 0;
+            for (uint64_t w : r->bitmap) r->in_use += static_cast<uint32_t>(__builtin_popcountll(w));
+
+            if (r->in_use == 0)                chunk_release(h, i);
+            else if (r->in_use < r->capacity)  partial_push(h, r);
+            break;
+        }
+        case CHUNK_FREE:
+            chunk_release(h, i);
+            break;
+        default:
+            return false;
+        }
+    }
+    return arena_rebuild(h->arena);
+}
+
+static size_t meta_bytes(size_t max_size) {
+    size_t bytes = sizeof(PHeader) + (max_size / RUN_SIZE) * sizeof(uint32_t);
+    return (bytes + RUN_SIZE - 1) & ~(RUN_SIZE - 1);
+}
+
+static void* reserve_at(void* base, size_t size) {
+#ifdef MAP_FIXED_NOREPLACE
+    int fixed = MAP_FIXED_NOREPLACE;
+#else
+    int fixed = 0;
+#endif
+    void* p = ::mmap(base, size, PROT_NONE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | fixed, -1, 0);
+    if (p == MAP_FAILED) return nullptr;
+    if (p != base) {   // hint not honoured: something lives there
+        ::munmap(p, size);
+        errno = EEXIST;
+        return nullptr;
+    }
+    return p;
+}
+
+static MA_PHeap* open_fail(MA_PHeap* ph, void* reserved, size_t size, int err) {
+    if (reserved) ::munmap(reserved, size);
+    if (ph->fd >= 0) ::close(ph->fd);
+    delete ph;
+    errno = err;
+    return nullptr;
+}
+
+} // namespace ma
+
+extern "C" MA_PHeap* ma_pheap_open(const char* path, void* base, size_t max_size) {
+    using namespace ma;
+
+    MA_PHeap* ph = new (std::nothrow) MA_PHeap{};
+    if (!ph) return nullptr;
+    ph->fd = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (ph->fd < 0) return open_fail(ph, nullptr, 0, errno);
+
+    // one process at a time
+    if (::flock(ph->fd, LOCK_EX | LOCK_NB) != 0) return open_fail(ph, nullptr, 0, errno);
+
+    struct stat st;
+    if (::fstat(ph->fd, &st) != 0) return open_fail(ph, nullptr, 0, errno);
+
+    // no magic: new, or its creation never finished
+    PHeader saved{};
+    bool    fresh = ::pread(ph->fd, &saved, sizeof(saved), 0) != ssize_t(sizeof(saved)) ||
+                    saved.magic == 0;
+    if (!fresh) {
+        if (saved.magic != PHEAP_MAGIC || saved.version != PHEAP_VERSION)
+            return open_fail(ph, nullptr, 0, EINVAL);
+        if (!base)     base     = reinterpret_cast<void*>(saved.base);
+        if (!max_size) max_size = saved.max_size;
+        if (base != reinterpret_cast<void*>(saved.base) || max_size != saved.max_size ||
+            size_t(st.st_size) < saved.top)
+            return open_fail(ph, nullptr, 0, EINVAL);
+    } else {
+        max_size &= ~(RUN_SIZE - 1);
+        if (max_size / RUN_SIZE > (UINT32_MAX >> 2) ||
+            max_size < meta_bytes(max_size) + PHEAP_GROW)
+            return open_fail(ph, nullptr, 0, EINVAL);
+    }
+    if (!base || reinterpret_cast<uintptr_t>(base) % RUN_SIZE)
+        return open_fail(ph, nullptr, 0, EINVAL);
+
+    void* reserved = reserve_at(base, max_size);
+    if (!reserved) return open_fail(ph, nullptr, 0, errno);
+
+    size_t meta = meta_bytes(max_size);
+    size_t size = fresh ? meta : size_t(st.st_size) & ~(RUN_SIZE - 1);
+    if (fresh && (::ftruncate(ph->fd, 0) != 0 || ::ftruncate(ph->fd, static_cast<off_t>(size)) != 0))
+        return open_fail(ph, reserved, max_size, errno);
+    if (::mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, ph->fd, 0) == MAP_FAILED)
+        return open_fail(ph, reserved, max_size, errno);
+
+    ph->hdr    = static_cast<PHeader*>(base);
+    ph->mapped = size;
+
+    PHeader* h = ph->hdr;
+    if (fresh) {
+        h->version     = PHEAP_VERSION;
+        h->base        = reinterpret_cast<uintptr_t>(base);
+        h->max_size    = max_size;
+        h->top         = meta;
+        h->meta_chunks = meta / RUN_SIZE;
+        for (size_t i = 0; i < h->meta_chunks; i++) h->chunk_map[i] = chunk_entry(CHUNK_META);
+        h->magic       = PHEAP_MAGIC;   // last: a file without it is started over
+    } else if (h->dirty) {
+        if (!recover(h)) return open_fail(ph, reserved, max_size, EIO);
+        ph->recovered = true;
+    }
+    h->dirty = 1;
+    return ph;
+}
+
+extern "C" void ma_pheap_close(MA_PHeap* ph) {
+    if (!ph) return;
+    ph->hdr->dirty = 0;
+    ::msync(ph->hdr, ph->mapped, MS_SYNC);
+    ::munmap(ph->hdr, ph->hdr->max_size);
+    ::close(ph->fd);
+    delete ph;
+}
+
+extern "C" int ma_pheap_sync(MA_PHeap* ph) {
+    auto lock = ma::lock_if_threaded(ph->lock);
+    return ::msync(ph->hdr, ph->mapped, MS_SYNC) == 0 ? 0 : -1;
+}
+
+extern "C" int ma_pheap_recovered(const MA_PHeap* ph) {
+    return ph->recovered ? 1 : 0;
+}
+
+extern "C" void* ma_pheap_alloc(MA_PHeap* ph, size_t size) {
+    using namespace ma;
+    if (size == 0) size = 1;
+
+    auto lock = lock_if_threaded(ph->lock);
+    if (size <= SMALL_MAX) return run_alloc(ph, size);
+
+    size_t needed = arena_block_size(size);
+    if (needed < size) return nullptr;
+    for (;;) {
+        if (void* p = arena_take(ph->hdr->arena, needed)) return p;
+        if (!region_grow(ph, needed)) return nullptr;
+    }
+}
+
+extern "C" void ma_pheap_free(MA_PHeap* ph, void* ptr) {
+    using namespace ma;
+    if (!ptr) return;
+
+    PHeader* h = ph->hdr;
+    char*    p = static_cast<char*>(ptr);
+    auto lock  = lock_if_threaded(ph->lock);
+    if (p < chunk_addr(h, h->meta_chunks) || p >= reinterpret_cast<char*>(h) + h->top) return;
+
+    size_t i = chunk_index(h, p);
+    switch (h->chunk_map[i] & 3) {
+    case CHUNK_RUN:
+        run_free(h, reinterpret_cast<PRun*>(chunk_addr(h, i)), p);
+        break;
+    case CHUNK_ARENA: {
+        BlockHeader* b = payload_to_header(p);
+        if (b->magic == BLOCK_MAGIC && b->in_use)
+            arena_give(h->arena, b, region_at(h, i));
+        break;
+    }
+    }
+}
+
+extern "C" void* ma_pheap_root(MA_PHeap* ph) {
+    auto lock = ma::lock_if_threaded(ph->lock);
+    return ph->hdr->root;
+}
+
+extern "C" void ma_pheap_set_root(MA_PHeap* ph, void* root) {
+    auto lock = ma::lock_if_threaded(ph->lock);
+    ph->hdr->root = root;
+}
@@ -2,8 +2,12 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <ctime>
 #include <sys/mman.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 namespace ma::platform {
 
@@ -18,11 +22,80 @@ inline void vm_free(void* ptr, size_t size) {
     ::munmap(ptr, size);
 }
 
+// fault the pages covering [ptr, ptr + size) in for writing now rather
+// than on first touch; contents are left as they were
+inline void vm_populate(void* ptr, size_t size) {
+    size_t    ps = static_cast<size_t>(::getpagesize());
+    uintptr_t lo = reinterpret_cast<uintptr_t>(ptr) & ~(uintptr_t)(ps - 1);
+    uintptr_t hi = reinterpret_cast<uintptr_t>(ptr) + size;
+#ifdef MADV_POPULATE_WRITE
+    if (::madvise(reinterpret_cast<void*>(lo), hi - lo, MADV_POPULATE_WRITE) == 0) return;
+#endif
+    // older kernels: rewrite one byte per page
+    for (uintptr_t a = reinterpret_cast<uintptr_t>(ptr); a < hi; a = (a & ~(uintptr_t)(ps - 1)) + ps) {
+        volatile char* b = reinterpret_cast<volatile char*>(a);
+        *b = *b;
+    }
+}
+
+// drop the pages' contents but keep the mapping; next touch reads zeros
+inline void vm_purge(void* ptr, size_t size) {
+    ::madvise(ptr, size, MADV_DONTNEED);
+}
+
+// map size bytes aligned to align (power of two, multiple of page size)
+// over-maps by align and trims the slack on both sides
+inline void* vm_alloc_aligned(size_t size, size_t align) {
+    char* raw = static_cast<char*>(vm_alloc(size + align));
+    if (!raw) return nullptr;
+
+    uintptr_t addr    = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = (addr + align - 1) & ~(uintptr_t)(align - 1);
+    size_t    head    = aligned - addr;
+    size_t    tail    = align - head;
+
+    if (head) ::munmap(raw, head);
+    if (tail) ::munmap(reinterpret_cast<char*>(aligned) + size, tail);
+    return reinterpret_cast<void*>(aligned);
+}
+
+// Ask the kernel to fault the pages of [ptr, ptr + size) in from node
+// (MPOL_PREFERRED through a raw mbind, so no libnuma is needed). It is a
+// hint: without NUMA support, or for node ids past the mask, nothing changes.
+inline void vm_bind_node(void* ptr, size_t size, unsigned node) {
+#if defined(__linux__) && defined(SYS_mbind)
+    constexpr int      MPOL_PREFERRED_ = 1;
+    constexpr unsigned MASK_BITS       = 8 * sizeof(unsigned long);
+    if (node >= MASK_BITS) return;
+
+    unsigned long mask = 1ul << node;
+    // the kernel reads maxnode - 1 bits
+    ::syscall(SYS_mbind, ptr, size, MPOL_PREFERRED_, &mask, MASK_BITS + 1, 0u);
+#else
+    (void)ptr; (void)size; (void)node;
+#endif
+}
+
+// the CPU the caller is running on, or -1 if unknown
+inline int current_cpu() {
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu = 0;
+    if (::syscall(SYS_getcpu, &cpu, nullptr, nullptr) == 0) return static_cast<int>(cpu);
+#endif
+    return -1;
+}
+
 inline size_t page_size() {
     static size_t ps = static_cast<size_t>(::getpagesize());
     return ps;
 }
 
+inline uint64_t monotonic_ns() {
+    timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ull + uint64_t(ts.tv_nsec);
+}
+
 uint32_t thread_id();
 
 } // namespace ma::platform
\ No newline at end of file
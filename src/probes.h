@@ -0,0 +1,27 @@
+#pragma once
+
+// USDT tracepoints on the slow paths, provider "memalloc".
+//
+// Built in with -DENABLE_USDT=ON when <sys/sdt.h> (systemtap-sdt-dev) is
+// available. An unattached probe is a single nop in the instruction stream
+// plus a note in .note.stapsdt, so leaving them compiled in costs nothing
+// until bpftrace/perf/systemtap attaches:
+//
+//   bpftrace -e 'usdt:./app:memalloc:lock_wait { @ns = hist(arg0); }'
+//
+// Without the option (or the header) the macros expand to nothing.
+
+#if defined(MA_ENABLE_USDT) && MA_ENABLE_USDT && __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+
+#define MA_PROBE0(name)          DTRACE_PROBE(memalloc, name)
+#define MA_PROBE1(name, a)       DTRACE_PROBE1(memalloc, name, a)
+#define MA_PROBE2(name, a, b)    DTRACE_PROBE2(memalloc, name, a, b)
+
+#else
+
+#define MA_PROBE0(name)          do {} while (0)
+#define MA_PROBE1(name, a)       do { (void)sizeof(a); } while (0)
+#define MA_PROBE2(name, a, b)    do { (void)sizeof(a); (void)sizeof(b); } while (0)
+
+#endif
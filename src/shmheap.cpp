@@ -0,0 +1,658 @@
+#include "internal.h"
+#include "slab.h"
+#include "../include/memalloc/memalloc.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <new>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+// ── Shared heaps ──────────────────────────────────────────────────────────────
+// A heap in a memfd that cooperating processes map wherever their address
+// space has room, so nothing inside it is a pointer: runs, free lists and
+// remote-free stacks link through offsets from the heap's base. The fd is
+// cut into RUN_SIZE chunks:
+//
+//   [ShmHeader + chunk map] [chunk] [chunk] ...
+//
+// Sizes up to 16KB come from runs of one class: the small size classes,
+// then powers of two from 1KB. Each run belongs to one attached process,
+// which allocates from its local free list under the handle's lock, like a
+// thread with its own runs. Other processes free into the run's
+// remote_free Treiber stack, which the owner drains on refill, through the
+// same push and drain as slab runs. Larger sizes
+// take whole chunks, as spans carved first fit from a list of free spans
+// that coalesce through the chunk map. Spans, orphaned runs and process
+// slots sit under one robust, process-shared mutex in the header.
+//
+// A process that exits without ma_shm_detach keeps its slot until the next
+// attach notices the pid is gone and hands its runs to the orphan lists,
+// where allocations of the same class adopt them. If it dies while holding
+// the header lock, the free-span and orphan lists may be half linked, so
+// the next locker rebuilds them from the chunk map (heap_recover).
+
+namespace ma {
+
+static constexpr uint64_t SHM_MAGIC       = 0x504145484D48534DULL;   // "MSHMHEAP"
+static constexpr uint32_t SHM_VERSION     = 1;
+static constexpr size_t   SHM_MAX_PROCS   = 64;
+static constexpr size_t   SHM_RUN_MAX     = 16384;                    // larger: whole chunks
+static constexpr size_t   SHM_CLASS_COUNT = SIZE_CLASS_COUNT + 5;     // + 1KB..16KB
+static constexpr int      SHM_RUN_SCAN    = 4;
+static constexpr uint32_t SHM_ORPHANED    = 0;                        // owner of an orphaned run
+
+// chunk map entry: kind in the low 3 bits, a span's length in chunks above
+enum : uint32_t { CH_UNUSED = 0, CH_META = 1, CH_RUN = 2, CH_SPAN = 3, CH_FREE = 4, CH_TAIL = 5 };
+
+static constexpr uint32_t chunk_entry(uint32_t kind, size_t len = 0) {
+    return static_cast<uint32_t>(len << 3) | kind;
+}
+static constexpr uint32_t chunk_kind(uint32_t e) { return e & 7; }
+static constexpr size_t   chunk_len(uint32_t e)  { return e >> 3; }
+
+// A span's head chunk records its length. Every other chunk of a live span
+// is a tail holding the same length, so a free can step back over its
+// left neighbour. In a free span, only the last chunk is kept up to date.
+// Each head changes in one store, and take and give write a span's head
+// only once the span it covers is settled, so wherever they stop, the
+// heads still tile the heap and heap_recover can trust them.
+
+// Not a SlabRun: every link in that header (runs, free lists, remote
+// stack, dtor) is a pointer, which means nothing in another process.
+
+struct ShmRun {
+    uint32_t              magic;
+    uint32_t              class_id;
+    uint32_t              block_size;
+    uint32_t              capacity;
+    uint32_t              in_use;
+    std::atomic<uint32_t> owner;         // slot + 1; SHM_ORPHANED while on an orphan list
+    uint64_t              local_free;    // owner only
+    uint64_t              next;          // owner's ring of the class, or an orphan list
+    uint64_t              prev;
+
+    // remote freers write here; kept off the owner's line
+    alignas(CACHE_LINE) std::atomic<uint64_t> remote_free;
+};
+
+static constexpr size_t SHM_RUN_DATA = (sizeof(ShmRun) + CACHE_LINE - 1) & ~(CACHE_LINE - 1);
+
+struct ShmFreeSpan {
+    uint64_t prev;
+    uint64_t next;
+};
+
+struct ShmHeader {
+    uint64_t             magic;
+    uint32_t             version;
+    uint32_t             meta_chunks;     // header + chunk map
+    uint64_t             size;
+    uint64_t             chunk_count;
+    pthread_mutex_t      lock;            // process-shared, robust
+    uint64_t             free_spans;      // under lock
+    uint64_t             orphans[SHM_CLASS_COUNT];   // under lock, linked through next
+    std::atomic<int32_t> slots[SHM_MAX_PROCS];       // pid per attached handle, 0 free
+    uint32_t             chunk_map[];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+              std::atomic<int32_t>::is_always_lock_free,
+              "shared-heap atomics must not need a lock");
+
+} // namespace ma
+
+struct MA_ShmHeap {
+    ma::ShmHeader* hdr;
+    int            fd;
+    uint32_t       owner;    // slot + 1
+    std::mutex     lock;     // this process's runs
+    uint64_t       current[ma::SHM_CLASS_COUNT];   // run being allocated from
+    uint64_t       runs[ma::SHM_CLASS_COUNT];      // ring of the others it owns
+};
+
+namespace ma {
+
+// ── addressing ──
+
+static char* base_of(ShmHeader* h) {
+    return reinterpret_cast<char*>(h);
+}
+
+template <typename T>
+static T* at(ShmHeader* h, uint64_t off) {
+    return reinterpret_cast<T*>(base_of(h) + off);
+}
+
+static uint64_t off_of(ShmHeader* h, const void* p) {
+    return uint64_t(static_cast<const char*>(p) - base_of(h));
+}
+
+static uint64_t chunk_off(size_t i) {
+    return uint64_t(i) * RUN_SIZE;
+}
+
+// ── size classes ──
+
+static size_t shm_class(size_t size) {
+    if (size <= SMALL_MAX) return size_class(round8(size));
+    size_t lg = 64 - __builtin_clzll(size - 1);   // 10 for 513..1024
+    return SIZE_CLASS_COUNT + (lg - 10);
+}
+
+static size_t shm_class_size(size_t cls) {
+    return cls < SIZE_CLASS_COUNT ? class_to_size(cls) : size_t(1024) << (cls - SIZE_CLASS_COUNT);
+}
+
+// ── header lock ──
+
+static bool heap_recover(ShmHeader* h);
+
+// false if the heap can't be used: the lock is left unrecoverable
+static bool header_lock(ShmHeader* h) {
+    int rc = pthread_mutex_lock(&h->lock);
+#ifdef __linux__
+    if (rc == EOWNERDEAD) {
+        // the previous holder died with it, maybe partway through a list update
+        if (!heap_recover(h)) {
+            pthread_mutex_unlock(&h->lock);   // not consistent: ENOTRECOVERABLE from now on
+            return false;
+        }
+        pthread_mutex_consistent(&h->lock);
+        return true;
+    }
+#endif
+    return rc == 0;
+}
+
+// test it before touching anything the lock guards
+struct HeaderGuard {
+    ShmHeader* h;
+    bool       ok;
+    explicit HeaderGuard(ShmHeader* hdr) : h(hdr), ok(header_lock(hdr)) {}
+    ~HeaderGuard() {
+        if (ok) pthread_mutex_unlock(&h->lock);
+    }
+    explicit operator bool() const { return ok; }
+};
+
+// ── spans (header lock held) ──
+
+static void span_link(ShmHeader* h, size_t i) {
+    ShmFreeSpan* s = at<ShmFreeSpan>(h, chunk_off(i));
+    s->prev = 0;
+    s->next = h->free_spans;
+    if (h->free_spans) at<ShmFreeSpan>(h, h->free_spans)->prev = chunk_off(i);
+    h->free_spans = chunk_off(i);
+}
+
+static void span_unlink(ShmHeader* h, size_t i) {
+    ShmFreeSpan* s = at<ShmFreeSpan>(h, chunk_off(i));
+    if (s->prev) at<ShmFreeSpan>(h, s->prev)->next = s->next;
+    else         h->free_spans = s->next;
+    if (s->next) at<ShmFreeSpan>(h, s->next)->prev = s->prev;
+}
+
+static void span_mark_free(ShmHeader* h, size_t i, size_t n) {
+    h->chunk_map[i] = chunk_entry(CH_FREE, n);
+    if (n > 1) h->chunk_map[i + n - 1] = chunk_entry(CH_TAIL, n);
+    span_link(h, i);
+}
+
+// first fit; returns the head chunk, or 0 if nothing is big enough
+static size_t span_take(ShmHeader* h, size_t n, uint32_t kind) {
+    for (uint64_t off = h->free_spans; off; off = at<ShmFreeSpan>(h, off)->next) {
+        size_t i   = off / RUN_SIZE;
+        size_t len = chunk_len(h->chunk_map[i]);
+        if (len < n) continue;
+
+        span_unlink(h, i);
+        if (len > n) span_mark_free(h, i + n, len - n);
+
+        h->chunk_map[i] = chunk_entry(kind, n);
+        for (size_t j = i + 1; j < i + n; j++) h->chunk_map[j] = chunk_entry(CH_TAIL, n);
+        return i;
+    }
+    return 0;
+}
+
+static void span_give(ShmHeader* h, size_t i) {
+    size_t n = chunk_len(h->chunk_map[i]);   // 1 for a run
+
+    size_t right = i + n;
+    if (right < h->chunk_count && chunk_kind(h->chunk_map[right]) == CH_FREE) {
+        span_unlink(h, right);
+        n += chunk_len(h->chunk_map[right]);
+    }
+    if (i > h->meta_chunks) {
+        uint32_t e    = h->chunk_map[i - 1];
+        size_t   left = chunk_kind(e) == CH_TAIL ? i - chunk_len(e) : i - 1;
+        if (chunk_kind(h->chunk_map[left]) == CH_FREE) {
+            span_unlink(h, left);
+            n += chunk_len(h->chunk_map[left]);
+            i  = left;
+        }
+    }
+    span_mark_free(h, i, n);
+}
+
+// ── runs ──
+
+static void ring_push(ShmHeader* h, uint64_t& head, uint64_t off) {
+    ShmRun* r = at<ShmRun>(h, off);
+    if (!head) {
+        r->next = r->prev = off;
+        head = off;
+        return;
+    }
+    ShmRun* first = at<ShmRun>(h, head);
+    ShmRun* last  = at<ShmRun>(h, first->prev);
+    r->prev     = first->prev;
+    r->next     = head;
+    last->next  = off;
+    first->prev = off;
+}
+
+static void ring_remove(ShmHeader* h, uint64_t& head, uint64_t off) {
+    ShmRun* r = at<ShmRun>(h, off);
+    if (r->next == off) {
+        head = 0;
+    } else {
+        at<ShmRun>(h, r->prev)->next = r->next;
+        at<ShmRun>(h, r->next)->prev = r->prev;
+        if (head == off) head = r->next;
+    }
+    r->next = r->prev = 0;
+}
+
+// move remote frees onto the local list
+static void run_drain(ShmHeader* h, ShmRun* r) {
+    r->in_use -= remote_drain(r->remote_free, r->local_free,
+                              [h](uint64_t off) { return at<char>(h, off); });
+}
+
+static uint64_t run_new(MA_ShmHeap* ph, size_t cls) {
+    ShmHeader* h = ph->hdr;
+    size_t     i;
+    {
+        HeaderGuard g(h);
+        if (!g) return 0;
+        i = span_take(h, 1, CH_RUN);
+    }
+    if (!i) return 0;
+
+    ShmRun* r     = at<ShmRun>(h, chunk_off(i));
+    r->class_id   = static_cast<uint32_t>(cls);
+    r->block_size = static_cast<uint32_t>(shm_class_size(cls));
+    r->capacity   = static_cast<uint32_t>((RUN_SIZE - SHM_RUN_DATA) / r->block_size);
+    r->in_use     = 0;
+    r->next = r->prev = 0;
+    r->remote_free.store(0, std::memory_order_relaxed);
+    r->owner.store(ph->owner, std::memory_order_relaxed);
+
+    uint64_t first = chunk_off(i) + SHM_RUN_DATA;
+    for (uint32_t b = 0; b < r->capacity; b++) {
+        uint64_t next = b + 1 < r->capacity ? first + uint64_t(b + 1) * r->block_size : 0;
+        memcpy(at<char>(h, first + uint64_t(b) * r->block_size), &next, sizeof(next));
+    }
+    r->local_free = first;
+    r->magic      = RUN_MAGIC;
+    return chunk_off(i);
+}
+
+static void run_release(ShmHeader* h, uint64_t off) {
+    at<ShmRun>(h, off)->magic = 0;
+    HeaderGuard g(h);
+    if (g) span_give(h, off / RUN_SIZE);   // else the chunk is lost with the heap
+}
+
+// an orphaned run of cls with the handle as its new owner, or 0
+static uint64_t run_adopt(MA_ShmHeap* ph, size_t cls) {
+    ShmHeader* h = ph->hdr;
+    HeaderGuard g(h);
+    uint64_t off = g ? h->orphans[cls] : 0;
+    if (!off) return 0;
+
+    ring_remove(h, h->orphans[cls], off);
+    at<ShmRun>(h, off)->owner.store(ph->owner, std::memory_order_relaxed);
+    return off;
+}
+
+// give up a run: back to the spans if empty, else onto its orphan list
+static void run_disown(ShmHeader* h, uint64_t off) {
+    ShmRun* r = at<ShmRun>(h, off);
+    run_drain(h, r);
+    if (r->in_use == 0) return run_release(h, off);
+
+    HeaderGuard g(h);
+    if (!g) return;
+    r->owner.store(SHM_ORPHANED, std::memory_order_relaxed);
+    ring_push(h, h->orphans[r->class_id], off);
+}
+
+// handle lock held
+static uint64_t refill(MA_ShmHeap* ph, size_t cls) {
+    ShmHeader* h = ph->hdr;
+    if (uint64_t cur = ph->current[cls]) ring_push(h, ph->runs[cls], cur);
+    ph->current[cls] = 0;
+
+    // the oldest runs first: remote frees have had longest to land there
+    for (int n = 0; n < SHM_RUN_SCAN && ph->runs[cls]; n++) {
+        uint64_t off = ph->runs[cls];
+        ShmRun*  r   = at<ShmRun>(h, off);
+        run_drain(h, r);
+        if (r->local_free) {
+            ring_remove(h, ph->runs[cls], off);
+            return off;
+        }
+        ph->runs[cls] = r->next;
+    }
+
+    uint64_t off = run_adopt(ph, cls);
+    if (off) {
+        run_drain(h, at<ShmRun>(h, off));
+        if (at<ShmRun>(h, off)->local_free) return off;
+        ring_push(h, ph->runs[cls], off);   // full: keep it with the others
+    }
+    return run_new(ph, cls);
+}
+
+static void* run_alloc(MA_ShmHeap* ph, size_t size) {
+    ShmHeader* h   = ph->hdr;
+    size_t     cls = shm_class(size);
+
+    std::lock_guard<std::mutex> lock(ph->lock);
+    uint64_t off = ph->current[cls];
+    if (off) run_drain(h, at<ShmRun>(h, off));
+    if (!off || !at<ShmRun>(h, off)->local_free) {
+        off = refill(ph, cls);
+        if (!off) return nullptr;
+        ph->current[cls] = off;
+    }
+
+    ShmRun*  r     = at<ShmRun>(h, off);
+    uint64_t block = r->local_free;
+    memcpy(&r->local_free, at<char>(h, block), sizeof(uint64_t));
+    r->in_use++;
+    return at<char>(h, block);
+}
+
+static void run_free(MA_ShmHeap* ph, uint64_t run_off, void* ptr) {
+    ShmHeader* h   = ph->hdr;
+    ShmRun*    r   = at<ShmRun>(h, run_off);
+    uint64_t   off = off_of(h, ptr);
+    uint64_t   rel = off - run_off;
+    if (rel < SHM_RUN_DATA || (rel - SHM_RUN_DATA) % r->block_size) return;
+    if ((rel - SHM_RUN_DATA) / r->block_size >= r->capacity) return;
+
+    if (r->owner.load(std::memory_order_relaxed) != ph->owner) {
+        // another process's run (or an orphan): its Treiber stack
+        remote_push(r->remote_free, off, [h](uint64_t b) { return at<char>(h, b); });
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(ph->lock);
+    memcpy(ptr, &r->local_free, sizeof(uint64_t));
+    r->local_free = off;
+    if (--r->in_use == 0 && ph->current[r->class_id] != run_off) {
+        ring_remove(h, ph->runs[r->class_id], run_off);
+        run_release(h, run_off);
+    }
+}
+
+// ── slots ──
+
+static bool pid_gone(int32_t pid) {
+    return ::kill(pid, 0) != 0 && errno == ESRCH;
+}
+
+// header lock held: orphan every run owned by a slot whose process is gone
+static void reap_dead_slots(ShmHeader* h) {
+    for (size_t s = 0; s < SHM_MAX_PROCS; s++) {
+        int32_t pid = h->slots[s].load(std::memory_order_acquire);
+        if (!pid || !pid_gone(pid)) continue;
+
+        uint32_t owner = static_cast<uint32_t>(s + 1);
+        for (size_t i = h->meta_chunks; i < h->chunk_count; i++) {
+            if (chunk_kind(h->chunk_map[i]) != CH_RUN) continue;
+            ShmRun* r = at<ShmRun>(h, chunk_off(i));
+            if (r->magic != RUN_MAGIC || r->owner.load(std::memory_order_relaxed) != owner) continue;
+
+            r->owner.store(SHM_ORPHANED, std::memory_order_relaxed);
+            ring_push(h, h->orphans[r->class_id], chunk_off(i));
+        }
+        h->slots[s].store(0, std::memory_order_release);
+    }
+}
+
+// 0, or the errno for attach to fail with
+static int claim_slot(MA_ShmHeap* ph) {
+    ShmHeader* h = ph->hdr;
+    HeaderGuard g(h);
+    if (!g) return ENOTRECOVERABLE;
+    reap_dead_slots(h);
+
+    for (size_t s = 0; s < SHM_MAX_PROCS; s++) {
+        if (h->slots[s].load(std::memory_order_relaxed)) continue;
+        h->slots[s].store(static_cast<int32_t>(::getpid()), std::memory_order_release);
+        ph->owner = static_cast<uint32_t>(s + 1);
+        return 0;
+    }
+    return EBUSY;
+}
+
+// header lock held, its last holder dead. The chunk map is whole (see the
+// span notes above) but the lists hanging off it may not be: relink the
+// free spans and orphans from the map, rewriting tails on the way. A span
+// or run the dead process had taken but not handed out stays lost.
+static bool heap_recover(ShmHeader* h) {
+    size_t end = h->chunk_count;
+    for (size_t i = 0; i < h->meta_chunks; i++)
+        if (h->chunk_map[i] != chunk_entry(CH_META)) return false;
+
+    // check every head before changing anything
+    for (size_t i = h->meta_chunks; i < end;) {
+        uint32_t e   = h->chunk_map[i];
+        size_t   len = chunk_len(e);
+        uint32_t k   = chunk_kind(e);
+        if ((k != CH_FREE && k != CH_SPAN && k != CH_RUN) || len == 0 || len > end - i ||
+            (k == CH_RUN && len != 1))
+            return false;
+        i += len;
+    }
+
+    h->free_spans = 0;
+    for (size_t cls = 0; cls < SHM_CLASS_COUNT; cls++) h->orphans[cls] = 0;
+
+    for (size_t i = h->meta_chunks; i < end;) {
+        uint32_t e   = h->chunk_map[i];
+        size_t   len = chunk_len(e);
+        if (chunk_kind(e) == CH_FREE) {
+            // an interrupted give can leave free neighbours unmerged
+            while (i + len < end && chunk_kind(h->chunk_map[i + len]) == CH_FREE)
+                len += chunk_len(h->chunk_map[i + len]);
+            span_mark_free(h, i, len);
+        } else {
+            for (size_t j = i + 1; j < i + len; j++) h->chunk_map[j] = chunk_entry(CH_TAIL, len);
+            ShmRun* r = at<ShmRun>(h, chunk_off(i));
+            if (chunk_kind(e) == CH_RUN && r->magic == RUN_MAGIC && r->class_id < SHM_CLASS_COUNT &&
+                r->owner.load(std::memory_order_relaxed) == SHM_ORPHANED)
+                ring_push(h, h->orphans[r->class_id], chunk_off(i));
+        }
+        i += len;
+    }
+    return true;
+}
+
+static size_t meta_bytes(size_t chunks) {
+    size_t bytes = sizeof(ShmHeader) + chunks * sizeof(uint32_t);
+    return (bytes + RUN_SIZE - 1) & ~(RUN_SIZE - 1);
+}
+
+static MA_ShmHeap* open_fail(MA_ShmHeap* ph, void* mem, size_t size, int err) {
+    if (mem) ::munmap(mem, size);
+    if (ph->fd >= 0) ::close(ph->fd);
+    delete ph;
+    errno = err;
+    return nullptr;
+}
+
+static void heap_format(ShmHeader* h, size_t size) {
+    size_t chunks  = size / RUN_SIZE;
+    h->version     = SHM_VERSION;
+    h->size        = size;
+    h->chunk_count = chunks;
+    h->meta_chunks = static_cast<uint32_t>(meta_bytes(chunks) / RUN_SIZE);
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+#ifdef __linux__
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+#endif
+    pthread_mutex_init(&h->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    for (size_t i = 0; i < h->meta_chunks; i++) h->chunk_map[i] = chunk_entry(CH_META);
+    span_mark_free(h, h->meta_chunks, chunks - h->meta_chunks);
+
+    // last: attach refuses a heap without it
+    __atomic_store_n(&h->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+}
+
+} // namespace ma
+
+extern "C" MA_ShmHeap* ma_shm_create(const char* name, size_t size) {
+    using namespace ma;
+
+    size &= ~(RUN_SIZE - 1);
+    size_t chunks = size / RUN_SIZE;
+    if (chunks > (UINT32_MAX >> 3) || size < meta_bytes(chunks) + RUN_SIZE) {
+        errno = EINVAL;
+        return nullptr;
+    }
+
+    MA_ShmHeap* ph = new (std::nothrow) MA_ShmHeap{};
+    if (!ph) return nullptr;
+
+#if defined(__linux__) && defined(SYS_memfd_create)
+    ph->fd = static_cast<int>(::syscall(SYS_memfd_create, name ? name : "memalloc", 1u /* MFD_CLOEXEC */));
+#else
+    (void)name;
+    ph->fd = -1;
+    errno  = ENOSYS;
+#endif
+    if (ph->fd < 0) return open_fail(ph, nullptr, 0, errno);
+    if (::ftruncate(ph->fd, static_cast<off_t>(size)) != 0) return open_fail(ph, nullptr, 0, errno);
+
+    void* mem = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, ph->fd, 0);
+    if (mem == MAP_FAILED) return open_fail(ph, nullptr, 0, errno);
+
+    ph->hdr = static_cast<ShmHeader*>(mem);
+    heap_format(ph->hdr, size);
+    if (int err = claim_slot(ph)) return open_fail(ph, mem, size, err);
+    return ph;
+}
+
+extern "C" MA_ShmHeap* ma_shm_attach(int fd) {
+    using namespace ma;
+
+    MA_ShmHeap* ph = new (std::nothrow) MA_ShmHeap{};
+    if (!ph) return nullptr;
+    ph->fd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (ph->fd < 0) return open_fail(ph, nullptr, 0, errno);
+
+    struct stat st;
+    if (::fstat(ph->fd, &st) != 0) return open_fail(ph, nullptr, 0, errno);
+    size_t size = size_t(st.st_size);
+    if (size < sizeof(ShmHeader)) return open_fail(ph, nullptr, 0, EINVAL);
+
+    void* mem = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, ph->fd, 0);
+    if (mem == MAP_FAILED) return open_fail(ph, nullptr, 0, errno);
+
+    ShmHeader* h = static_cast<ShmHeader*>(mem);
+    if (__atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC ||
+        h->version != SHM_VERSION || h->size != size)
+        return open_fail(ph, mem, size, EINVAL);
+
+    ph->hdr = h;
+    if (int err = claim_slot(ph)) return open_fail(ph, mem, size, err);
+    return ph;
+}
+
+extern "C" void ma_shm_detach(MA_ShmHeap* ph) {
+    using namespace ma;
+    if (!ph) return;
+
+    ShmHeader* h = ph->hdr;
+    {
+        std::lock_guard<std::mutex> lock(ph->lock);
+        for (size_t cls = 0; cls < SHM_CLASS_COUNT; cls++) {
+            if (uint64_t cur = ph->current[cls]) run_disown(h, cur);
+            while (uint64_t off = ph->runs[cls]) {
+                ring_remove(h, ph->runs[cls], off);
+                run_disown(h, off);
+            }
+        }
+    }
+    h->slots[ph->owner - 1].store(0, std::memory_order_release);
+
+    ::munmap(h, h->size);
+    ::close(ph->fd);
+    delete ph;
+}
+
+extern "C" int ma_shm_fd(const MA_ShmHeap* ph) {
+    return ph->fd;
+}
+
+extern "C" void* ma_shm_alloc(MA_ShmHeap* ph, size_t size) {
+    using namespace ma;
+    if (size == 0) size = 1;
+    if (size <= SHM_RUN_MAX) return run_alloc(ph, size);
+
+    ShmHeader* h = ph->hdr;
+    if (size > h->size) return nullptr;
+    size_t n = (size + RUN_SIZE - 1) / RUN_SIZE;
+
+    HeaderGuard g(h);
+    size_t i = g ? span_take(h, n, CH_SPAN) : 0;
+    return i ? at<char>(h, chunk_off(i)) : nullptr;
+}
+
+extern "C" void ma_shm_free(MA_ShmHeap* ph, void* ptr) {
+    using namespace ma;
+    if (!ptr) return;
+
+    ShmHeader* h   = ph->hdr;
+    uint64_t   off = off_of(h, ptr);
+    if (off < chunk_off(h->meta_chunks) || off >= h->size) return;
+
+    size_t   i = off / RUN_SIZE;
+    uint32_t e = h->chunk_map[i];
+    if (chunk_kind(e) == CH_RUN) {
+        run_free(ph, chunk_off(i), ptr);
+    } else if (chunk_kind(e) == CH_SPAN && off % RUN_SIZE == 0) {
+        HeaderGuard g(h);
+        if (g) span_give(h, i);
+    }
+}
+
+extern "C" size_t ma_shm_offset(const MA_ShmHeap* ph, const void* ptr) {
+    const char* base = reinterpret_cast<const char*>(ph->hdr);
+    const char* p    = static_cast<const char*>(ptr);
+    return p > base && p < base + ph->hdr->size ? size_t(p - base) : 0;
+}
+
+extern "C" void* ma_shm_ptr(const MA_ShmHeap* ph, size_t offset) {
+    if (!offset || offset >= ph->hdr->size) return nullptr;
+    return reinterpret_cast<char*>(ph->hdr) + offset;
+}
@@ -1,27 +1,46 @@
 #include "slab.h"
 #include "platform.h"
 #include "stats.h"
+#include "probes.h"
+#include "threading.h"
+#include "numa.h"
 
 #include <cstring>
 
 namespace ma {
 
-SlabRun* slab_run_init(void* mem, uint32_t class_id) {
+RunLayout slab_class_layout(uint32_t class_id) {
+    return {class_id, static_cast<uint32_t>(class_to_size(class_id)),
+            8, 0, nullptr, nullptr};
+}
+
+static void* link_of(SlabRun* run, void* block) {
+    return static_cast<char*>(block) + run->link_offset;
+}
+
+SlabRun* slab_run_init(void* mem, const RunLayout& layout) {
     SlabRun* run       = static_cast<SlabRun*>(mem);
-    run->magic         = RUN_MAGIC;
-    run->class_id      = class_id;
-    run->block_size    = static_cast<uint32_t>(class_to_size(class_id));
-    run->owner_tid     = platform::thread_id();
+    run->class_id      = layout.class_id;
+    run->block_size    = layout.block_size;
+    run->owner_tid.store(platform::thread_id(), std::memory_order_relaxed);
     run->next_run      = nullptr;
+    run->prev_run      = nullptr;
     run->local_free    = nullptr;
+    run->link_offset   = static_cast<uint16_t>(layout.link_offset);
+    run->obj_dtor      = layout.dtor;
     run->remote_free.store(nullptr, std::memory_order_relaxed);
+    run->node          = static_cast<uint16_t>(numa_thread_node());   // arena_alloc_run took it from there
 
-    // blocks start after header, aligned to CACHE_LINE
-    size_t header_sz = (sizeof(SlabRun) + CACHE_LINE - 1) & ~(CACHE_LINE - 1);
+    // blocks start after header, aligned to CACHE_LINE (or the layout's alignment)
+    size_t align     = layout.align > CACHE_LINE ? layout.align : CACHE_LINE;
+    size_t header_sz = (sizeof(SlabRun) + align - 1) & ~(align - 1);
     char*  base      = static_cast<char*>(mem) + header_sz;
     size_t usable    = RUN_SIZE - header_sz;
+    run->data_offset = static_cast<uint32_t>(header_sz);
     run->capacity    = static_cast<uint32_t>(usable / run->block_size);
     run->in_use      = 0;
+    // last: a heap walk reads the header once it sees the magic
+    __atomic_store_n(&run->magic, RUN_MAGIC, __ATOMIC_RELEASE);
 
     // build intrusive free list
     for (uint32_t i = 0; i < run->capacity; i++) {
@@ -29,7 +48,8 @@ SlabRun* slab_run_init(void* mem, uint32_t class_id) {
         void* next  = (i + 1 < run->capacity)
                       ? base + (i + 1) * run->block_size
                       : nullptr;
-        memcpy(block, &next, sizeof(void*));
+        if (layout.ctor) layout.ctor(block);
+        memcpy(link_of(run, block), &next, sizeof(void*));
     }
 
     run->local_free = base;
@@ -38,12 +58,16 @@ SlabRun* slab_run_init(void* mem, uint32_t class_id) {
     return run;
 }
 
+SlabRun* slab_run_init(void* mem, uint32_t class_id) {
+    return slab_run_init(mem, slab_class_layout(class_id));
+}
+
 void* slab_run_alloc(SlabRun* run) {
     if (!run->local_free) return nullptr;
 
     void* block = run->local_free;
     void* next;
-    memcpy(&next, block, sizeof(void*));
+    memcpy(&next, link_of(run, block), sizeof(void*));
 
     run->local_free = next;
     run->in_use++;
@@ -53,41 +77,59 @@ void* slab_run_alloc(SlabRun* run) {
 }
 
 void slab_run_free(SlabRun* run, void* ptr) {
-    if (platform::thread_id() == run->owner_tid) {
+    // single-threaded, every run is ours until our cache is torn down
+    uint32_t owner = run->owner_tid.load(std::memory_order_relaxed);
+    if (single_threaded() ? owner != RUN_ORPHANED : owner == platform::thread_id()) {
         // owner thread
-        memcpy(ptr, &run->local_free, sizeof(void*));
+        memcpy(link_of(run, ptr), &run->local_free, sizeof(void*));
         run->local_free = ptr;
         run->in_use--;
 
         stats_slab_inuse_dec();
     } else {
-        // remote thread — Treiber stack
+        slab_run_free_remote(run, ptr);
+        stats_event(EV_REMOTE_FREE);
+    }
+}
+
+void slab_run_free_remote(SlabRun* run, void* ptr) {
+    // Treiber stack; whoever drains the run decrements in_use
+    if (single_threaded()) {
         void* old_head = run->remote_free.load(std::memory_order_relaxed);
-        do {
-            memcpy(ptr, &old_head, sizeof(void*));
-        } while (!run->remote_free.compare_exchange_weak(
-            old_head, ptr,
-            std::memory_order_release,
-            std::memory_order_relaxed));
-        // owner decrements in_use when draining
+        memcpy(link_of(run, ptr), &old_head, sizeof(void*));
+        run->remote_free.store(ptr, std::memory_order_relaxed);
+        return;
+    }
+
+    uint64_t retries = remote_push(run->remote_free, ptr,
+                                   [run](void* b) { return link_of(run, b); });
+    // the run may be gone by now (drained and unmapped) — don't touch it
+    if (retries) {
+        stats_event(EV_CAS_RETRY, retries);
+        MA_PROBE2(cas_retry, run, retries);
     }
 }
 
 void slab_run_drain_remote(SlabRun* run) {
-    void* head = run->remote_free.exchange(nullptr, std::memory_order_acquire);
+    // cheap check first: owners call this on every refill
+    if (!run->remote_free.load(std::memory_order_relaxed)) return;
 
-    while (head) {
-        void* next;
-        memcpy(&next, head, sizeof(void*));
-
-        memcpy(head, &run->local_free, sizeof(void*));
-        run->local_free = head;
+    void* head;
+    if (single_threaded()) {
+        head = run->remote_free.load(std::memory_order_relaxed);
+        run->remote_free.store(nullptr, std::memory_order_relaxed);
+    } else {
+        head = run->remote_free.exchange(nullptr, std::memory_order_acquire);
+    }
 
-        run->in_use--;
-        stats_slab_inuse_dec();
+    uint32_t drained = remote_splice(head, run->local_free,
+                                     [run](void* b) { return link_of(run, b); });
+    run->in_use -= drained;
+    stats_slab_inuse_dec(drained);
 
-        head = next;
-    }
+    stats_event(EV_REMOTE_DRAIN);
+    stats_event(EV_REMOTE_DRAINED, drained);
+    MA_PROBE2(remote_drain, run, drained);
 }
 
 bool slab_run_empty(SlabRun* run) {
@@ -2,9 +2,25 @@
 
 #include "internal.h"
 
+#include <cstring>
+
 namespace ma {
 
-// initialize a freshly mmap'd RUN_SIZE block as a slab run for class_id
+// how a run is carved: size classes use slab_class_layout, object caches
+// place the free-list link after the object so a free object stays intact
+struct RunLayout {
+    uint32_t class_id;
+    uint32_t block_size;
+    uint32_t align;          // power of two
+    uint32_t link_offset;
+    void   (*ctor)(void*);   // run on every block when the run is carved
+    void   (*dtor)(void*);   // stored in the run for when it is unmapped
+};
+
+RunLayout slab_class_layout(uint32_t class_id);
+
+// initialize a freshly mmap'd RUN_SIZE block as a slab run
+SlabRun* slab_run_init(void* mem, const RunLayout& layout);
 SlabRun* slab_run_init(void* mem, uint32_t class_id);
 
 // allocate one block from a run — caller must be owner thread
@@ -13,9 +29,55 @@ void* slab_run_alloc(SlabRun* run);
 // free a block back to its run — detects owner vs remote thread
 void slab_run_free(SlabRun* run, void* ptr);
 
+// push onto the run's remote_free stack regardless of the calling thread —
+// used when the owner must not touch local_free (run not current, or orphaned)
+void slab_run_free_remote(SlabRun* run, void* ptr);
+
 // drain remote_free stack into local_free — call before alloc when local empty
 void slab_run_drain_remote(SlabRun* run);
 
+// ── remote-free stacks ──
+// The Treiber stack behind every cross-owner free. Slab runs name a block
+// by its address; shared-heap runs (shmheap.cpp) by its offset from the
+// heap base, which is the same in every process. W is that name, link(w)
+// the word in block w that holds the next one, and W{} ends a chain.
+
+// push block onto stack; returns the failed CAS attempts
+template <typename W, typename Link>
+inline uint64_t remote_push(std::atomic<W>& stack, W block, Link link) {
+    W        head    = stack.load(std::memory_order_relaxed);
+    uint64_t retries = 0;
+    for (;;) {
+        memcpy(link(block), &head, sizeof(W));
+        if (stack.compare_exchange_weak(head, block, std::memory_order_release,
+                                        std::memory_order_relaxed))
+            return retries;
+        retries++;
+    }
+}
+
+// move a chain taken off a stack onto local_free; returns its length
+template <typename W, typename Link>
+inline uint32_t remote_splice(W head, W& local_free, Link link) {
+    uint32_t n = 0;
+    while (head != W{}) {
+        W next;
+        memcpy(&next, link(head), sizeof(W));
+        memcpy(link(head), &local_free, sizeof(W));
+        local_free = head;
+        head       = next;
+        n++;
+    }
+    return n;
+}
+
+// take everything on stack onto local_free; returns how many blocks
+template <typename W, typename Link>
+inline uint32_t remote_drain(std::atomic<W>& stack, W& local_free, Link link) {
+    if (stack.load(std::memory_order_relaxed) == W{}) return 0;
+    return remote_splice(stack.exchange(W{}, std::memory_order_acquire), local_free, link);
+}
+
 // true if run has no live allocations
 bool slab_run_empty(SlabRun* run);
 
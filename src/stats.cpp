@@ -1,5 +1,8 @@
 #include "stats.h"
 #include "arena.h"
+#include "internal.h"
+#include "config.h"
+#include "platform.h"
 #include "../include/memalloc/memalloc.h"
 
 #include <cstdio>
@@ -9,98 +12,276 @@ namespace ma {
 
 Stats g_stats;
 
-// Tune flush thresholds (bigger = fewer atomics)
-static constexpr size_t FLUSH_BYTES_THRESHOLD = 64 * 1024; // 64 KiB
-static constexpr size_t FLUSH_OPS_THRESHOLD   = 4096;
+constinit thread_local uint32_t tl_slow_path = 0;
 
-struct TLSBatchedStats {
-    size_t req_bytes = 0;
-    size_t alloc_bytes_add = 0;
-    size_t alloc_bytes_sub = 0;
-    size_t meta_bytes = 0;
+// ── Per-thread stat slots ─────────────────────────────────────────────────────
+// Each thread owns one cache-line-padded slot of monotonic counters. Only the
+// owner writes it (plain load + release store, no RMW), so the hot path costs
+// the same as the old TLS batch. Readers sum every slot with acquire loads.
+//
+// Slots are carved from vm_alloc'd chunks and never unmapped; a slot whose
+// thread exited is folded into g_stats, zeroed and handed to the next thread.
 
-    size_t slab_inuse_inc = 0;
-    size_t slab_inuse_dec = 0;
-    size_t slab_capacity_add = 0;
+enum : uint32_t { SLOT_FREE = 0, SLOT_ACTIVE = 1, SLOT_EXITED = 2 };
 
-    size_t ops = 0;
+struct alignas(CACHE_LINE) StatsSlot {
+    std::atomic<size_t> req_bytes;
+    std::atomic<size_t> alloc_bytes_add;
+    std::atomic<size_t> alloc_bytes_sub;
+    std::atomic<size_t> meta_bytes;
+
+    std::atomic<size_t> slab_inuse_inc;
+    std::atomic<size_t> slab_inuse_dec;
+    std::atomic<size_t> slab_capacity_add;
+
+    std::atomic<uint64_t> events[STAT_EVENT_COUNT];
+
+    std::atomic<uint32_t> state;
+    StatsSlot*            next;     // registry link, immutable once published
 };
 
-static thread_local TLSBatchedStats tl;
+static_assert(offsetof(StatsSlot, req_bytes) == offsetof(detail::FastCounters, requested) &&
+              offsetof(StatsSlot, alloc_bytes_add) == offsetof(detail::FastCounters, allocated_add) &&
+              offsetof(StatsSlot, alloc_bytes_sub) == offsetof(detail::FastCounters, allocated_sub) &&
+              offsetof(StatsSlot, slab_inuse_inc) == offsetof(detail::FastCounters, slab_inuse_inc) &&
+              offsetof(StatsSlot, slab_inuse_dec) == offsetof(detail::FastCounters, slab_inuse_dec),
+              "fast.h FastCounters must mirror StatsSlot");
 
-static inline void flush_if_needed() {
-    if (tl.ops < FLUSH_OPS_THRESHOLD &&
-        (tl.req_bytes + tl.alloc_bytes_add + tl.alloc_bytes_sub + tl.meta_bytes) < FLUSH_BYTES_THRESHOLD) {
-        return;
-    }
+static std::atomic<StatsSlot*> g_slots{nullptr};
 
-    if (tl.req_bytes) {
-        g_stats.bytes_requested.fetch_add(tl.req_bytes, std::memory_order_relaxed);
-        tl.req_bytes = 0;
-    }
-    if (tl.alloc_bytes_add) {
-        g_stats.bytes_allocated.fetch_add(tl.alloc_bytes_add, std::memory_order_relaxed);
-        tl.alloc_bytes_add = 0;
-    }
-    if (tl.alloc_bytes_sub) {
-        g_stats.bytes_allocated.fetch_sub(tl.alloc_bytes_sub, std::memory_order_relaxed);
-        tl.alloc_bytes_sub = 0;
-    }
-    if (tl.meta_bytes) {
-        g_stats.bytes_metadata.fetch_add(tl.meta_bytes, std::memory_order_relaxed);
-        tl.meta_bytes = 0;
+// odd while an exiting thread moves its slot into g_stats — readers retry
+static std::atomic<uint64_t>   g_fold_seq{0};
+
+static std::atomic<bool>       g_defer_folds{false};
+
+static thread_local StatsSlot* tl_slot   = nullptr;
+static thread_local bool       tl_exited = false;
+
+static StatsSlot* slot_claim_existing() {
+    for (StatsSlot* s = g_slots.load(std::memory_order_acquire); s; s = s->next) {
+        uint32_t expected = SLOT_FREE;
+        if (s->state.load(std::memory_order_relaxed) == SLOT_FREE &&
+            s->state.compare_exchange_strong(expected, SLOT_ACTIVE,
+                                             std::memory_order_acquire,
+                                             std::memory_order_relaxed))
+            return s;
     }
+    return nullptr;
+}
+
+static StatsSlot* slot_claim_new() {
+    size_t chunk_sz = platform::page_size();
+    size_t n        = chunk_sz / sizeof(StatsSlot);
+
+    // fresh anonymous pages are zeroed: counters are 0 and state is SLOT_FREE
+    StatsSlot* chunk = static_cast<StatsSlot*>(platform::vm_alloc(chunk_sz));
+    if (!chunk) return nullptr;
+
+    chunk[0].state.store(SLOT_ACTIVE, std::memory_order_relaxed);
+    for (size_t i = 0; i + 1 < n; i++)
+        chunk[i].next = &chunk[i + 1];
 
-    if (tl.slab_inuse_inc) {
-        g_stats.slab_in_use.fetch_add(tl.slab_inuse_inc, std::memory_order_relaxed);
-        tl.slab_inuse_inc = 0;
+    StatsSlot* head = g_slots.load(std::memory_order_relaxed);
+    do {
+        chunk[n - 1].next = head;
+    } while (!g_slots.compare_exchange_weak(head, chunk,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed));
+    return &chunk[0];
+}
+
+template <typename T>
+static T take(std::atomic<T>& c) {
+    return c.exchange(0, std::memory_order_relaxed);
+}
+
+static void slot_fold(StatsSlot* s) {
+    uint64_t seq = g_fold_seq.load(std::memory_order_relaxed);
+    while ((seq & 1) ||
+           !g_fold_seq.compare_exchange_weak(seq, seq + 1,
+                                             std::memory_order_relaxed))
+        seq = g_fold_seq.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    g_stats.bytes_requested.fetch_add(take(s->req_bytes), std::memory_order_relaxed);
+    g_stats.bytes_allocated.fetch_add(take(s->alloc_bytes_add), std::memory_order_relaxed);
+    g_stats.bytes_allocated.fetch_sub(take(s->alloc_bytes_sub), std::memory_order_relaxed);
+    g_stats.bytes_metadata.fetch_add(take(s->meta_bytes), std::memory_order_relaxed);
+    g_stats.slab_in_use.fetch_add(take(s->slab_inuse_inc), std::memory_order_relaxed);
+    g_stats.slab_in_use.fetch_sub(take(s->slab_inuse_dec), std::memory_order_relaxed);
+    g_stats.slab_capacity.fetch_add(take(s->slab_capacity_add), std::memory_order_relaxed);
+    for (uint32_t i = 0; i < STAT_EVENT_COUNT; i++)
+        g_stats.events[i].fetch_add(take(s->events[i]), std::memory_order_relaxed);
+
+    g_fold_seq.store(seq + 2, std::memory_order_release);
+    s->state.store(SLOT_FREE, std::memory_order_release);
+}
+
+struct SlotReaper {
+    ~SlotReaper() {
+        if (tl_slot) {
+            if (g_defer_folds.load(std::memory_order_acquire))
+                tl_slot->state.store(SLOT_EXITED, std::memory_order_release);
+            else
+                slot_fold(tl_slot);
+        }
+        detail::tl_fast.stats = nullptr;
+        tl_slot   = nullptr;
+        tl_exited = true;
     }
-    if (tl.slab_inuse_dec) {
-        g_stats.slab_in_use.fetch_sub(tl.slab_inuse_dec, std::memory_order_relaxed);
-        tl.slab_inuse_dec = 0;
+};
+
+void stats_defer_folds(bool on) {
+    g_defer_folds.store(on, std::memory_order_release);
+}
+
+size_t stats_fold_exited() {
+    size_t folded = 0;
+    for (StatsSlot* s = g_slots.load(std::memory_order_acquire); s; s = s->next) {
+        uint32_t expected = SLOT_EXITED;
+        // claim it so a concurrent pass can't fold it twice
+        if (s->state.compare_exchange_strong(expected, SLOT_ACTIVE,
+                                             std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+            slot_fold(s);
+            folded++;
+        }
     }
-    if (tl.slab_capacity_add) {
-        g_stats.slab_capacity.fetch_add(tl.slab_capacity_add, std::memory_order_relaxed);
-        tl.slab_capacity_add = 0;
+    return folded;
+}
+
+// slow path: first stats update on this thread
+// returns nullptr once the thread is tearing down — callers fall back to g_stats
+static StatsSlot* slot_acquire() {
+    if (tl_exited) return nullptr;
+
+    StatsSlot* s = slot_claim_existing();
+    if (!s) s = slot_claim_new();
+    if (!s) return nullptr;
+
+    static thread_local SlotReaper reaper;
+    (void)reaper;
+
+    tl_slot = s;
+    detail::tl_fast.stats = reinterpret_cast<detail::FastCounters*>(s);
+    return s;
+}
+
+template <bool Sub>
+static inline void bump(std::atomic<size_t> StatsSlot::*field,
+                        std::atomic<size_t>& global, size_t n) {
+    StatsSlot* s = tl_slot;
+    if (__builtin_expect(!s, 0)) {
+        s = slot_acquire();
+        if (!s) {
+            if (Sub) global.fetch_sub(n, std::memory_order_relaxed);
+            else     global.fetch_add(n, std::memory_order_relaxed);
+            return;
+        }
     }
+    std::atomic<size_t>& c = s->*field;
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_release);
+}
 
-    tl.ops = 0;
+void stats_event(StatEvent ev, uint64_t n) {
+    if (!g_config.stats_events.load(std::memory_order_relaxed)) return;
+
+    StatsSlot* s = tl_slot;
+    if (__builtin_expect(!s, 0)) {
+        s = slot_acquire();
+        if (!s) {
+            g_stats.events[ev].fetch_add(n, std::memory_order_relaxed);
+            return;
+        }
+    }
+    std::atomic<uint64_t>& c = s->events[ev];
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_release);
 }
 
 void stats_add_requested(size_t bytes) {
-    tl.req_bytes += bytes;
-    tl.ops++;
-    flush_if_needed();
+    bump<false>(&StatsSlot::req_bytes, g_stats.bytes_requested, bytes);
 }
 void stats_add_allocated(size_t bytes) {
-    tl.alloc_bytes_add += bytes;
-    tl.ops++;
-    flush_if_needed();
+    bump<false>(&StatsSlot::alloc_bytes_add, g_stats.bytes_allocated, bytes);
 }
 void stats_sub_allocated(size_t bytes) {
-    tl.alloc_bytes_sub += bytes;
-    tl.ops++;
-    flush_if_needed();
+    bump<true>(&StatsSlot::alloc_bytes_sub, g_stats.bytes_allocated, bytes);
 }
 void stats_add_metadata(size_t bytes) {
-    tl.meta_bytes += bytes;
-    tl.ops++;
-    flush_if_needed();
+    bump<false>(&StatsSlot::meta_bytes, g_stats.bytes_metadata, bytes);
 }
 void stats_slab_inuse_inc() {
-    tl.slab_inuse_inc += 1;
-    tl.ops++;
-    flush_if_needed();
+    bump<false>(&StatsSlot::slab_inuse_inc, g_stats.slab_in_use, 1);
 }
-void stats_slab_inuse_dec() {
-    tl.slab_inuse_dec += 1;
-    tl.ops++;
-    flush_if_needed();
+void stats_slab_inuse_dec(size_t blocks) {
+    bump<true>(&StatsSlot::slab_inuse_dec, g_stats.slab_in_use, blocks);
 }
 void stats_slab_capacity_add(size_t blocks) {
-    tl.slab_capacity_add += blocks;
-    tl.ops++;
-    flush_if_needed();
+    bump<false>(&StatsSlot::slab_capacity_add, g_stats.slab_capacity, blocks);
+}
+
+// Sum globals + every slot. Decrements are read before increments: a free
+// that we observe happened after its matching alloc, so the net counters
+// never go negative. The fold sequence guards against a slot being moved
+// into g_stats mid-read (counted twice or not at all).
+void stats_collect(StatsTotals* out) {
+    auto ld = [](const std::atomic<size_t>& c) {
+        return c.load(std::memory_order_acquire);
+    };
+
+    for (;;) {
+        uint64_t seq = g_fold_seq.load(std::memory_order_acquire);
+        if (seq & 1) continue;
+
+        size_t alloc_sub = 0, inuse_dec = 0;
+        StatsSlot* head = g_slots.load(std::memory_order_acquire);
+        for (StatsSlot* s = head; s; s = s->next) {
+            alloc_sub += ld(s->alloc_bytes_sub);
+            inuse_dec += ld(s->slab_inuse_dec);
+        }
+
+        size_t req   = ld(g_stats.bytes_requested);
+        size_t alloc = ld(g_stats.bytes_allocated);
+        size_t meta  = ld(g_stats.bytes_metadata);
+        size_t inuse = ld(g_stats.slab_in_use);
+        size_t cap   = ld(g_stats.slab_capacity);
+
+        for (StatsSlot* s = head; s; s = s->next) {
+            req   += ld(s->req_bytes);
+            alloc += ld(s->alloc_bytes_add);
+            meta  += ld(s->meta_bytes);
+            inuse += ld(s->slab_inuse_inc);
+            cap   += ld(s->slab_capacity_add);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (g_fold_seq.load(std::memory_order_relaxed) != seq) continue;
+
+        // globals are net values and may individually wrap; the sum cannot
+        out->bytes_requested = req;
+        out->bytes_allocated = alloc - alloc_sub;
+        out->bytes_metadata  = meta;
+        out->slab_in_use     = inuse - inuse_dec;
+        out->slab_capacity   = cap;
+        return;
+    }
+}
+
+// events only grow, so no ordering games — just the fold guard
+void stats_collect_events(uint64_t* out) {
+    for (;;) {
+        uint64_t seq = g_fold_seq.load(std::memory_order_acquire);
+        if (seq & 1) continue;
+
+        for (uint32_t i = 0; i < STAT_EVENT_COUNT; i++)
+            out[i] = g_stats.events[i].load(std::memory_order_acquire);
+        for (StatsSlot* s = g_slots.load(std::memory_order_acquire); s; s = s->next)
+            for (uint32_t i = 0; i < STAT_EVENT_COUNT; i++)
+                out[i] += s->events[i].load(std::memory_order_acquire);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (g_fold_seq.load(std::memory_order_relaxed) == seq) return;
+    }
 }
 
 } // namespace ma
@@ -108,13 +289,15 @@ void stats_slab_capacity_add(size_t blocks) {
 extern "C" void ma_stats(MA_Stats* out) {
     using namespace ma;
 
-    // NOTE: we intentionally do NOT try to flush other threads' TLS batches.
-    // These are approximate counters by design — fast, not perfectly synchronized.
-    out->bytes_requested    = g_stats.bytes_requested.load(std::memory_order_relaxed);
-    out->bytes_allocated    = g_stats.bytes_allocated.load(std::memory_order_relaxed);
-    out->bytes_metadata     = g_stats.bytes_metadata.load(std::memory_order_relaxed);
-    out->slab_in_use        = g_stats.slab_in_use.load(std::memory_order_relaxed);
-    out->slab_capacity      = g_stats.slab_capacity.load(std::memory_order_relaxed);
+    // exact: includes every live thread's slot and everything folded from
+    // threads that have exited
+    StatsTotals t;
+    stats_collect(&t);
+    out->bytes_requested    = t.bytes_requested;
+    out->bytes_allocated    = t.bytes_allocated;
+    out->bytes_metadata     = t.bytes_metadata;
+    out->slab_in_use        = t.slab_in_use;
+    out->slab_capacity      = t.slab_capacity;
 
     size_t free_bytes = 0, largest = 0;
     ma::arena_free_stats(&free_bytes, &largest);
@@ -122,6 +305,24 @@ extern "C" void ma_stats(MA_Stats* out) {
     out->largest_free_block  = largest;
 }
 
+extern "C" void ma_event_stats(MA_EventStats* out) {
+    using namespace ma;
+
+    uint64_t ev[STAT_EVENT_COUNT];
+    stats_collect_events(ev);
+    out->lock_waits       = ev[EV_LOCK_WAIT];
+    out->lock_wait_ns     = ev[EV_LOCK_WAIT_NS];
+    out->cas_retries      = ev[EV_CAS_RETRY];
+    out->remote_frees     = ev[EV_REMOTE_FREE];
+    out->remote_drains    = ev[EV_REMOTE_DRAIN];
+    out->remote_drained   = ev[EV_REMOTE_DRAINED];
+    out->tcache_refills   = ev[EV_TCACHE_REFILL];
+    out->runs_mapped      = ev[EV_RUN_MAPPED];
+    out->runs_unmapped    = ev[EV_RUN_UNMAPPED];
+    out->regions_mapped   = ev[EV_REGION_MAPPED];
+    out->purged_bytes     = ev[EV_PURGED_BYTES];
+}
+
 extern "C" void ma_print_stats(void) {
     MA_Stats s;
     ma_stats(&s);
@@ -142,4 +343,18 @@ extern "C" void ma_print_stats(void) {
 
     printf("  internal frag:  %.1f%%\n", int_frag * 100.0);
     printf("  external frag:  %.1f%%\n", ext_frag * 100.0);
-}
\ No newline at end of file
+
+    MA_EventStats e;
+    ma_event_stats(&e);
+    printf("  lock waits:     %llu (%.3f ms)\n",
+           (unsigned long long)e.lock_waits, e.lock_wait_ns / 1e6);
+    printf("  cas retries:    %llu\n", (unsigned long long)e.cas_retries);
+    printf("  remote frees:   %llu (%llu drains, %llu blocks)\n",
+           (unsigned long long)e.remote_frees, (unsigned long long)e.remote_drains,
+           (unsigned long long)e.remote_drained);
+    printf("  tcache refills: %llu\n", (unsigned long long)e.tcache_refills);
+    printf("  runs:           %llu mapped, %llu unmapped\n",
+           (unsigned long long)e.runs_mapped, (unsigned long long)e.runs_unmapped);
+    printf("  regions:        %llu mapped\n", (unsigned long long)e.regions_mapped);
+    printf("  purged:         %llu B\n", (unsigned long long)e.purged_bytes);
+}
@@ -6,20 +6,38 @@
 
 namespace ma {
 
-// Global counters (still atomics, but we hit them rarely via batching)
+// one monotonic counter per slow path (see stats_event below)
+enum StatEvent : uint32_t {
+    EV_LOCK_WAIT,          // g_arena_lock was contended
+    EV_LOCK_WAIT_NS,       // time spent blocked on it
+    EV_CAS_RETRY,          // failed CAS pushing onto a run's remote_free stack
+    EV_REMOTE_FREE,        // blocks pushed onto another thread's run
+    EV_REMOTE_DRAIN,       // drains that found remote frees waiting
+    EV_REMOTE_DRAINED,     // blocks moved by those drains
+    EV_TCACHE_REFILL,      // thread cache misses
+    EV_RUN_MAPPED,
+    EV_RUN_UNMAPPED,
+    EV_REGION_MAPPED,
+    EV_PURGED_BYTES,       // free arena pages handed back by the background thread
+    STAT_EVENT_COUNT
+};
+
+// Global counters — hold the totals folded in from threads that have exited.
+// Live threads count into their own per-thread slot (see stats.cpp).
 struct Stats {
     std::atomic<size_t> bytes_requested{0};
     std::atomic<size_t> bytes_allocated{0};
     std::atomic<size_t> bytes_metadata{0};
     std::atomic<size_t> slab_in_use{0};
     std::atomic<size_t> slab_capacity{0};
+    std::atomic<uint64_t> events[STAT_EVENT_COUNT] = {};
 };
 
 extern Stats g_stats;
 
-// ----- Batched hot-path API -----
-// Goal: avoid atomics on every alloc/free.
-// We batch deltas in TLS and flush occasionally (relaxed atomics).
+// ----- Hot-path API -----
+// Goal: avoid atomic RMWs on every alloc/free.
+// Each thread bumps its own slot with a plain load + store.
 
 void stats_add_requested(size_t bytes);
 void stats_add_allocated(size_t bytes);
@@ -28,7 +46,55 @@ void stats_sub_allocated(size_t bytes);
 void stats_add_metadata(size_t bytes);
 
 void stats_slab_inuse_inc();
-void stats_slab_inuse_dec();
+void stats_slab_inuse_dec(size_t blocks = 1);
 void stats_slab_capacity_add(size_t blocks);
 
+// ----- Aggregation -----
+
+struct StatsTotals {
+    size_t bytes_requested;
+    size_t bytes_allocated;
+    size_t bytes_metadata;
+    size_t slab_in_use;
+    size_t slab_capacity;
+};
+
+// exact sum of g_stats and every thread's slot, without locks
+void stats_collect(StatsTotals* out);
+
+// ----- Slow-path events -----
+// Same cost model as the byte counters: the owning thread does a plain
+// load + store on its slot. Only slow paths call this. A no-op while
+// stats.enabled is off; the byte counters above are always kept.
+
+void stats_event(StatEvent ev, uint64_t n = 1);
+
+// events[i] = g_stats.events[i] + every live slot
+void stats_collect_events(uint64_t* out);
+
+// ----- Background folding -----
+// While deferred, exiting threads just mark their slot and the background
+// thread folds it into g_stats — totals stay exact either way.
+
+void   stats_defer_folds(bool on);
+size_t stats_fold_exited();
+
+// ----- Slow-path tagging -----
+// Each slow path ORs its bit into a thread-local mask. Tools clear it
+// before a single call and read it afterwards to attribute the latency
+// (see bench/bench_latency.cpp). The allocator itself never reads it.
+
+enum SlowPath : uint32_t {
+    SLOW_REFILL     = 1u << 0,   // thread cache miss, refilled from a run
+    SLOW_NEW_RUN    = 1u << 1,   // mapped and initialized a fresh slab run
+    SLOW_NEW_REGION = 1u << 2,   // mapped a new arena region
+    SLOW_LOCK_WAIT  = 1u << 3,   // g_arena_lock was contended
+};
+
+extern constinit thread_local uint32_t tl_slow_path;
+
+inline void stats_note_slow(uint32_t bits) {
+    tl_slow_path |= bits;
+}
+
 } // namespace ma
\ No newline at end of file
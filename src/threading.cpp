@@ -0,0 +1,25 @@
+#include "threading.h"
+
+#if MA_SINGLE_THREADED
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace ma {
+
+static uint32_t g_first_tid = UINT32_MAX;
+
+void threading_go_multi() {
+    fprintf(stderr, "memalloc: built with ENABLE_SINGLE_THREADED, "
+                    "a second thread allocated\n");
+    abort();
+}
+
+void threading_note_thread(uint32_t tid) {
+    if (g_first_tid == UINT32_MAX) g_first_tid = tid;
+    else if (tid != g_first_tid) threading_go_multi();
+}
+
+} // namespace ma
+
+#endif // MA_SINGLE_THREADED
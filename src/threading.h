@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+namespace ma {
+
+// Single-threaded mode. -DENABLE_SINGLE_THREADED=ON builds an allocator for
+// a process where only one thread ever allocates: it skips the arena and
+// cache locks, the owner check in slab_run_free and the CAS in remote
+// pushes. Other threads may exist as long as they stay out of the heap;
+// one that sets up a thread cache (tls_get) aborts the process. The
+// library never starts threads of its own in this build: background and
+// trace writers refuse to start.
+//
+// There is no runtime switch. A thread that libc starts without going
+// through pthread_create can't be seen before it runs, and by then the
+// first thread may already be inside an unlocked critical section.
+
+#if MA_SINGLE_THREADED
+
+constexpr bool single_threaded() { return true; }
+
+// abort: a second thread is using the heap
+[[noreturn]] void threading_go_multi();
+
+// at cache setup: abort unless tid is the first thread to set one up
+void threading_note_thread(uint32_t tid);
+
+#else
+
+constexpr bool single_threaded() { return false; }
+
+#endif
+
+// lock m, unless nobody could be contending for it
+inline std::unique_lock<std::mutex> lock_if_threaded(std::mutex& m) {
+    if (single_threaded()) return std::unique_lock<std::mutex>(m, std::defer_lock);
+    return std::unique_lock<std::mutex>(m);
+}
+
+} // namespace ma
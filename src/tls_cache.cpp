@@ -3,49 +3,275 @@
 #include "arena.h"
 #include "platform.h"
 #include "stats.h"
+#include "config.h"
+#include "threading.h"
 #include "internal.h"
+#include "probes.h"
+#include "numa.h"
+#include "pagemap.h"
 
 #include <cstring>
+#include <new>
 
 namespace ma {
 
-static thread_local TLSCache* tl_cache = nullptr;
+static thread_local TLSCache* tl_cache  = nullptr;
+static thread_local bool      tl_exited = false;
+
+// what ma::alloc<N> / ma::free<N> read inline (memalloc/fast.h)
+constinit thread_local detail::FastThread detail::tl_fast = {nullptr, nullptr,
+                                                             NUMA_NODE_UNSET};
+
+static_assert(sizeof(PerClassCache) == sizeof(detail::FastBin) &&
+              offsetof(PerClassCache, head) == offsetof(detail::FastBin, head) &&
+              offsetof(PerClassCache, count) == offsetof(detail::FastBin, count),
+              "fast.h FastBin must mirror PerClassCache");
+static_assert(SMALL_MAX == detail::FAST_SMALL_MAX, "fast.h size classes out of date");
+static_assert(RUN_SIZE == detail::FAST_RUN_SIZE &&
+              offsetof(SlabRun, node) == detail::FAST_RUN_NODE_OFFSET &&
+              sizeof(SlabRun::node) == sizeof(uint16_t),
+              "fast.h run layout out of date");
+
+// every live thread's cache, walked by the background thread
+static std::mutex g_caches_lock;
+static TLSCache*  g_caches = nullptr;
+
+// runs still holding blocks when their owner exited
+static std::mutex g_orphans_lock;
+static SlabRun*   g_orphans = nullptr;
+
+// retired runs a refill looks at before mapping a new one
+static constexpr int RETIRED_SCAN = 4;
+
+// ── run rings ─────────────────────────────────────────────────────────────────
+// circular, doubly linked through next_run/prev_run; head is the oldest
+
+static void ring_push(SlabRun*& head, SlabRun* r) {
+    if (!head) {
+        r->next_run = r->prev_run = r;
+        head = r;
+        return;
+    }
+    SlabRun* tail  = head->prev_run;
+    r->prev_run    = tail;
+    r->next_run    = head;
+    tail->next_run = r;
+    head->prev_run = r;
+}
+
+static void ring_remove(SlabRun*& head, SlabRun* r) {
+    if (r->next_run == r) {
+        head = nullptr;
+    } else {
+        r->prev_run->next_run = r->next_run;
+        r->next_run->prev_run = r->prev_run;
+        if (head == r) head = r->next_run;
+    }
+    r->next_run = r->prev_run = nullptr;
+}
+
+static void ring_splice(SlabRun*& dst, SlabRun* src) {
+    if (!src) return;
+    if (!dst) { dst = src; return; }
+    SlabRun* dst_tail = dst->prev_run;
+    SlabRun* src_tail = src->prev_run;
+    dst_tail->next_run = src;
+    src->prev_run      = dst_tail;
+    src_tail->next_run = dst;
+    dst->prev_run      = src_tail;
+}
+
+// unmap an empty run; object cache runs destroy their objects first
+static void release_run(SlabRun* r) {
+    if (r->obj_dtor) {
+        char* base = reinterpret_cast<char*>(r) + r->data_offset;
+        for (uint32_t i = 0; i < r->capacity; i++)
+            r->obj_dtor(base + size_t(i) * r->block_size);
+    }
+    arena_free_run(r);
+}
+
+// drain every run in the ring once and unmap the ones that emptied
+static size_t ring_reclaim(SlabRun*& head, uint32_t* run_count) {
+    if (!head) return 0;
+
+    size_t   unmapped = 0;
+    SlabRun* last     = head->prev_run;
+    SlabRun* r        = head;
+    for (;;) {
+        SlabRun* next = r->next_run;
+        bool     done = (r == last);
+
+        slab_run_drain_remote(r);
+        if (slab_run_empty(r)) {
+            ring_remove(head, r);
+            release_run(r);
+            if (run_count) (*run_count)--;
+            unmapped++;
+        }
+        if (done) break;
+        r = next;
+    }
+    return unmapped;
+}
+
+// ── flush ─────────────────────────────────────────────────────────────────────
+
+// Return cached blocks to their runs, unmap the class's empty runs and
+// collect the rest as orphans; the background thread drains orphans as
+// their blocks come back. The background thread must not be able to see
+// pc meanwhile — hold the cache lock, or unregister first.
+static void flush_class(PerClassCache& pc, SlabRun*& orphans) {
+    while (void* block = pc.head) {
+        SlabRun* run = slab_run_of(block);
+        memcpy(&pc.head, static_cast<char*>(block) + run->link_offset, sizeof(void*));
+        // cached blocks already count as free; slab_run_free counts them again
+        stats_slab_inuse_inc();
+        slab_run_free(run, block);
+    }
+    pc.count = 0;
+
+    if (pc.current_run) ring_push(pc.retired, pc.current_run);
+    pc.current_run = nullptr;
+
+    while (SlabRun* r = pc.retired) {
+        ring_remove(pc.retired, r);
+        slab_run_drain_remote(r);
+        if (slab_run_empty(r)) {
+            release_run(r);
+        } else {
+            r->owner_tid.store(RUN_ORPHANED, std::memory_order_relaxed);
+            ring_push(orphans, r);
+        }
+    }
+    pc.run_count = 0;
+}
+
+static void adopt_orphans(SlabRun* orphans) {
+    if (!orphans) return;
+    std::lock_guard<std::mutex> lock(g_orphans_lock);
+    ring_splice(g_orphans, orphans);
+}
+
+// ── thread exit ───────────────────────────────────────────────────────────────
+
+static void cache_teardown(TLSCache* cache) {
+    {
+        std::lock_guard<std::mutex> lock(g_caches_lock);
+        for (TLSCache** p = &g_caches; *p; p = &(*p)->next) {
+            if (*p == cache) { *p = cache->next; break; }
+        }
+    }
+    // unregistered: nothing else can see the cache now
+
+    epoch_thread_exit(cache->epoch);
+
+    SlabRun* orphans = nullptr;
+    for (size_t cls = 0; cls < SIZE_CLASS_COUNT; cls++)
+        flush_class(cache->classes[cls], orphans);
+
+    if (cache->objects) {
+        for (size_t id = 0; id < OBJ_CACHE_MAX; id++)
+            flush_class(cache->objects[id].pc, orphans);
+        platform::vm_free(cache->objects, OBJ_CACHE_MAX * sizeof(ObjSlot));
+    }
+
+    for (size_t bin = 0; bin < MEDIUM_BIN_COUNT; bin++) {
+        arena_free_chain(cache->medium[bin].head);
+        cache->medium[bin] = {nullptr, 0};
+    }
+
+    adopt_orphans(orphans);
+
+    cache->~TLSCache();
+    platform::vm_free(cache, sizeof(TLSCache));
+}
+
+struct CacheReaper {
+    ~CacheReaper() {
+        detail::tl_fast.bins = nullptr;
+        if (tl_cache) cache_teardown(tl_cache);
+        tl_cache  = nullptr;
+        tl_exited = true;
+    }
+};
 
 TLSCache* tls_get() {
     if (!tl_cache) {
         void* mem = platform::vm_alloc(sizeof(TLSCache));
-        tl_cache  = static_cast<TLSCache*>(mem);
+        tl_cache  = new (mem) TLSCache();
+        tl_cache->tid = platform::thread_id();
+#if MA_SINGLE_THREADED
+        threading_note_thread(tl_cache->tid);
+#endif
+        detail::tl_fast.bins = reinterpret_cast<detail::FastBin*>(tl_cache->classes);
+
+        // allocating from a later thread_local destructor gets a private
+        // cache that is never torn down — rare, and bounded per thread
+        if (!tl_exited) {
+            static thread_local CacheReaper reaper;
+            (void)reaper;
 
-        for (size_t i = 0; i < SIZE_CLASS_COUNT; i++) {
-            tl_cache->classes[i] = {nullptr, 0, 0, nullptr};
+            std::lock_guard<std::mutex> lock(g_caches_lock);
+            tl_cache->next = g_caches;
+            g_caches       = tl_cache;
         }
-        tl_cache->tid = platform::thread_id();
     }
     return tl_cache;
 }
 
-static void* refill_from_run(TLSCache* cache, size_t cls) {
-    PerClassCache& pc = cache->classes[cls];
+bool tls_thread_exited() {
+    return tl_exited;
+}
+
+// ── refill ────────────────────────────────────────────────────────────────────
+
+// caller holds cache->lock
+static SlabRun* take_retired(PerClassCache& pc) {
+    for (int i = 0; i < RETIRED_SCAN && pc.retired; i++) {
+        SlabRun* r = pc.retired;
+        slab_run_drain_remote(r);
+        if (r->local_free) {
+            ring_remove(pc.retired, r);
+            return r;
+        }
+        pc.retired = r->next_run;   // rotate so the next refill looks further on
+    }
+    return nullptr;
+}
+
+static void* refill_from_run(TLSCache* cache, PerClassCache& pc,
+                             const RunLayout& layout, PageKind kind) {
+    stats_note_slow(SLOW_REFILL);
+    stats_event(EV_TCACHE_REFILL);
+    MA_PROBE1(tcache_refill, layout.class_id);
 
     if (pc.current_run) {
         slab_run_drain_remote(pc.current_run);
         if (pc.current_run->local_free) {
             return slab_run_alloc(pc.current_run);
         }
+    }
 
-        if (slab_run_empty(pc.current_run)) {
-            arena_free_run(pc.current_run);
-            pc.current_run = nullptr;
-            pc.run_count--;
-        }
+    {
+        // exhausted: park it with the retired runs, where frees can refill
+        // it, and reuse the oldest retired run that has room
+        auto lock = lock_if_threaded(cache->lock);
+        if (pc.current_run) ring_push(pc.retired, pc.current_run);
+        pc.current_run = take_retired(pc);
     }
+    if (pc.current_run) return slab_run_alloc(pc.current_run);
 
-    void* mem = arena_alloc_run();
+    stats_note_slow(SLOW_NEW_RUN);
+    void* mem = arena_alloc_run(kind);
     if (!mem) return nullptr;
 
-    SlabRun* run   = slab_run_init(mem, static_cast<uint32_t>(cls));
+    SlabRun* run   = slab_run_init(mem, layout);
     pc.current_run = run;
-    pc.run_count++;
+    {
+        auto lock = lock_if_threaded(cache->lock);
+        pc.run_count++;
+    }
 
     stats_add_metadata(sizeof(SlabRun));
     return slab_run_alloc(run);
@@ -64,7 +290,34 @@ void* tls_alloc(size_t size) {
         return block;
     }
 
-    return refill_from_run(cache, cls);
+    return refill_from_run(cache, pc, slab_class_layout(static_cast<uint32_t>(cls)),
+                           PAGE_RUN);
+}
+
+void* tls_alloc_uncached(size_t size) {
+    size_t cls = size_class(round8(size));
+    TLSCache* cache   = tls_get();
+    PerClassCache& pc = cache->classes[cls];
+
+    if (pc.current_run && pc.current_run->local_free)
+        return slab_run_alloc(pc.current_run);
+    return refill_from_run(cache, pc, slab_class_layout(static_cast<uint32_t>(cls)),
+                           PAGE_RUN);
+}
+
+static void free_to_run(TLSCache* cache, PerClassCache& pc, SlabRun* run, void* ptr) {
+    // our own retired runs may be under the background thread's drain,
+    // so only the current run's local list is safe to touch unlocked
+    if (run != pc.current_run &&
+        run->owner_tid.load(std::memory_order_relaxed) == cache->tid)
+        slab_run_free_remote(run, ptr);
+    else
+        slab_run_free(run, ptr);
+}
+
+void tls_free_uncached(void* ptr, SlabRun* run) {
+    TLSCache* cache = tls_get();
+    free_to_run(cache, cache->classes[run->class_id], run, ptr);
 }
 
 void tls_free(void* ptr, SlabRun* run) {
@@ -72,8 +325,10 @@ void tls_free(void* ptr, SlabRun* run) {
     size_t cls        = run->class_id;
     PerClassCache& pc = cache->classes[cls];
 
-    if (pc.count >= TLS_MAX_LOCAL) {
-        slab_run_free(run, ptr);
+    // another node's block goes back to its run, not out again from here
+    if (pc.count >= detail::tcache_max.load(std::memory_order_relaxed) ||
+        run->node != numa_thread_node()) {
+        free_to_run(cache, pc, run, ptr);
         return;
     }
 
@@ -83,4 +338,243 @@ void tls_free(void* ptr, SlabRun* run) {
     stats_slab_inuse_dec();
 }
 
-} // namespace ma
\ No newline at end of file
+// ── medium cache ──────────────────────────────────────────────────────────────
+
+static size_t medium_payload(void* ptr) {
+    return payload_to_header(ptr)->size - BLOCK_OVERHEAD;
+}
+
+// each bin holds about tcache.medium_bytes, and 2..16 blocks; 0 when the
+// medium cache is switched off
+static uint32_t medium_bin_max(size_t bin) {
+    size_t bytes = g_config.medium_bin_bytes.load(std::memory_order_relaxed);
+    if (!bytes) return 0;
+
+    size_t lo = size_t(1) << (9 + bin / MEDIUM_BINS_PER_POW2);
+    size_t n  = bytes / lo;
+    return static_cast<uint32_t>(n < 2 ? 2 : n > 16 ? 16 : n);
+}
+
+static void* medium_pop(MediumBin& b) {
+    void* p = b.head;
+    memcpy(&b.head, p, sizeof(void*));
+    b.count--;
+    return p;
+}
+
+void* tls_alloc_medium(size_t size) {
+    TLSCache* cache = tls_get();
+    size_t    bin   = medium_bin(size);
+
+    // a same-size block lands in the request's own bin; anything in the
+    // next bin up fits whatever its size
+    MediumBin& same = cache->medium[bin];
+    if (same.head && medium_payload(same.head) >= size) return medium_pop(same);
+
+    MediumBin& up = cache->medium[bin + 1];
+    if (up.head) return medium_pop(up);
+    return nullptr;
+}
+
+bool tls_free_medium(void* ptr) {
+    size_t payload = medium_payload(ptr);
+    // explicit-arena and aligned requests can leave blocks below the bins
+    if (payload < SMALL_MAX || payload >= 2 * MEDIUM_MAX) return false;
+    if (pagemap_desc<ArenaRegion>(pagemap_get(ptr))->node != numa_thread_node()) return false;
+
+    TLSCache*  cache = tls_get();
+    size_t     bin   = medium_bin(payload);
+    MediumBin& b     = cache->medium[bin];
+
+    uint32_t max = medium_bin_max(bin);
+    if (!max) return false;
+    if (b.count >= max) {
+        // keep the newest half, give the older half back in one lock
+        void* keep = b.head;
+        for (uint32_t i = 1; i < max / 2; i++) memcpy(&keep, keep, sizeof(void*));
+        void* old;
+        memcpy(&old, keep, sizeof(void*));
+        void* end = nullptr;
+        memcpy(keep, &end, sizeof(void*));
+        b.count = max / 2;
+        arena_free_chain(old);
+    }
+
+    memcpy(ptr, &b.head, sizeof(void*));
+    b.head = ptr;
+    b.count++;
+    return true;
+}
+
+// ── warm-up ───────────────────────────────────────────────────────────────────
+
+size_t tls_warmup(size_t size, size_t count) {
+    TLSCache* cache = tls_get();
+    void*     chain = nullptr;
+    size_t    n     = 0;
+
+    if (size <= SMALL_MAX) {
+        PerClassCache& pc  = cache->classes[size_class(round8(size))];
+        size_t         max = detail::tcache_max.load(std::memory_order_relaxed);
+        if (pc.count >= max) return 0;
+        n = count < max - pc.count ? count : max - pc.count;
+
+        // take them all before giving any back, or the refill would just
+        // hand out the block we cached a moment ago
+        for (size_t i = 0; i < n; i++) {
+            void* p = tls_alloc(size);
+            if (!p) { n = i; break; }
+            memcpy(p, &chain, sizeof(void*));
+            chain = p;
+        }
+        while (chain) {
+            void* p = chain;
+            memcpy(&chain, p, sizeof(void*));
+            tls_free(p, slab_run_of(p));
+        }
+        return n;
+    }
+
+    MediumBin& b   = cache->medium[medium_bin(round8(size))];
+    uint32_t   max = medium_bin_max(medium_bin(round8(size)));
+    if (b.count >= max) return 0;
+    n = count < max - b.count ? count : max - b.count;
+
+    for (size_t i = 0; i < n; i++) {
+        void* p = arena_alloc(size);
+        if (!p) { n = i; break; }
+        platform::vm_populate(p, medium_payload(p));
+        memcpy(p, &chain, sizeof(void*));
+        chain = p;
+    }
+    while (chain) {
+        void* p = chain;
+        memcpy(&chain, p, sizeof(void*));
+        if (!tls_free_medium(p)) arena_free(p);
+    }
+    return n;
+}
+
+// ── object caches ─────────────────────────────────────────────────────────────
+
+// the calling thread's slot for cache id, flushed first if it belongs to
+// an earlier cache that had the same id; nullptr if the slots can't be mapped
+static ObjSlot* obj_slot(TLSCache* cache, uint32_t id, uint32_t gen) {
+    if (!cache->objects) {
+        // zeroed: gen 0 never matches a live cache
+        void* mem = platform::vm_alloc(OBJ_CACHE_MAX * sizeof(ObjSlot));
+        if (!mem) return nullptr;
+        std::lock_guard<std::mutex> lock(cache->lock);   // tls_reclaim reads it
+        cache->objects = static_cast<ObjSlot*>(mem);
+    }
+    ObjSlot& s = cache->objects[id];
+    if (s.gen != gen) {
+        tls_obj_flush(id);
+        s.gen = gen;
+    }
+    return &s;
+}
+
+void* tls_obj_alloc(uint32_t id, uint32_t gen, const RunLayout& layout) {
+    TLSCache* cache = tls_get();
+    ObjSlot*  slot  = obj_slot(cache, id, gen);
+    if (!slot) return nullptr;
+
+    PerClassCache& pc = slot->pc;
+    if (void* obj = pc.head) {
+        memcpy(&pc.head, static_cast<char*>(obj) + layout.link_offset, sizeof(void*));
+        pc.count--;
+        stats_slab_inuse_inc();
+        return obj;
+    }
+    return refill_from_run(cache, pc, layout, PAGE_OBJECT);
+}
+
+void tls_obj_free(uint32_t id, uint32_t gen, void* obj) {
+    TLSCache* cache = tls_get();
+    ObjSlot*  slot  = obj_slot(cache, id, gen);
+    SlabRun*  run   = slab_run_of(obj);
+    if (!slot) {
+        // no slots, so no runs of this thread's either: a remote free
+        slab_run_free(run, obj);
+        return;
+    }
+
+    PerClassCache& pc = slot->pc;
+
+    if (pc.count >= detail::tcache_max.load(std::memory_order_relaxed) ||
+        run->node != numa_thread_node()) {
+        // same rule as tls_free: retired runs only through the remote stack
+        if (run != pc.current_run &&
+            run->owner_tid.load(std::memory_order_relaxed) == cache->tid)
+            slab_run_free_remote(run, obj);
+        else
+            slab_run_free(run, obj);
+        return;
+    }
+
+    memcpy(static_cast<char*>(obj) + run->link_offset, &pc.head, sizeof(void*));
+    pc.head = obj;
+    pc.count++;
+    stats_slab_inuse_dec();
+}
+
+void tls_obj_flush(uint32_t id) {
+    TLSCache* cache = tls_get();
+    if (!cache->objects) return;
+
+    SlabRun* orphans = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(cache->lock);
+        flush_class(cache->objects[id].pc, orphans);
+    }
+    adopt_orphans(orphans);
+}
+
+void tls_flush() {
+    if (tls_thread_exited()) return;
+    TLSCache* cache = tls_get();
+
+    SlabRun* orphans = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(cache->lock);
+        for (size_t cls = 0; cls < SIZE_CLASS_COUNT; cls++)
+            flush_class(cache->classes[cls], orphans);
+        if (cache->objects) {
+            for (size_t id = 0; id < OBJ_CACHE_MAX; id++)
+                flush_class(cache->objects[id].pc, orphans);
+        }
+    }
+    for (size_t bin = 0; bin < MEDIUM_BIN_COUNT; bin++) {
+        arena_free_chain(cache->medium[bin].head);
+        cache->medium[bin] = {nullptr, 0};
+    }
+    adopt_orphans(orphans);
+}
+
+size_t tls_reclaim() {
+    size_t unmapped = 0;
+    {
+        std::lock_guard<std::mutex> lock(g_caches_lock);
+        for (TLSCache* c = g_caches; c; c = c->next) {
+            // owner is swapping runs right now — catch it next pass
+            std::unique_lock<std::mutex> cl(c->lock, std::try_to_lock);
+            if (!cl.owns_lock()) continue;
+            for (size_t cls = 0; cls < SIZE_CLASS_COUNT; cls++)
+                unmapped += ring_reclaim(c->classes[cls].retired,
+                                         &c->classes[cls].run_count);
+            if (c->objects) {
+                for (size_t id = 0; id < OBJ_CACHE_MAX; id++)
+                    unmapped += ring_reclaim(c->objects[id].pc.retired,
+                                             &c->objects[id].pc.run_count);
+            }
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_orphans_lock);
+        unmapped += ring_reclaim(g_orphans, nullptr);
+    }
+    return unmapped;
+}
+
+} // namespace ma
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "internal.h"
+#include "slab.h"
+#include "epoch.h"
+
+#include <mutex>
 
 namespace ma {
 
@@ -9,16 +13,76 @@ struct alignas(CACHE_LINE) PerClassCache {
     uint32_t count;      // how many blocks currently cached
     uint32_t run_count;  // how many runs assigned to this thread for this class
     SlabRun* current_run;
+    SlabRun* retired;    // ring of exhausted runs, oldest first (under TLSCache::lock)
+};
+
+// one object cache's per-thread state; gen tells a stale slot (cache
+// destroyed, id reused) from a live one
+struct alignas(CACHE_LINE) ObjSlot {
+    PerClassCache pc;
+    uint32_t      gen;
 };
 
+struct MediumBin {
+    void*    head;       // cached arena payloads, linked through their first word
+    uint32_t count;
+};
+
+// The owner touches head/count/current_run without locking. Retired runs
+// are shared with the background thread, so they and run_count are only
+// touched under lock — by the owner when it swaps current_run, by the
+// background thread when it unmaps retired runs that emptied out.
 struct alignas(CACHE_LINE) TLSCache {
     PerClassCache classes[SIZE_CLASS_COUNT];
+    MediumBin     medium[MEDIUM_BIN_COUNT];   // owner only, never locked
+    ObjSlot*      objects;                    // OBJ_CACHE_MAX slots, mapped on first use
+    EpochState    epoch;                      // owner only
     uint32_t      tid;
+    std::mutex    lock;
+    TLSCache*     next;  // registry link, under g_caches_lock
 };
 
 TLSCache* tls_get();
 
+// true once this thread's cache has been torn down; a later tls_get hands
+// out a private cache the registry doesn't list
+bool tls_thread_exited();
+
 void* tls_alloc(size_t size);
 void  tls_free(void* ptr, SlabRun* run);
 
-} // namespace ma
\ No newline at end of file
+// Cache bypass (MA_MALLOCX_TCACHE_NONE): take a block straight from the
+// class's current run, leaving cached blocks for ordinary allocations, and
+// give one straight back to its run — for blocks that are known to be
+// freed on another thread, or never reused here.
+void* tls_alloc_uncached(size_t size);
+void  tls_free_uncached(void* ptr, SlabRun* run);
+
+// Medium cache: recently freed arena blocks (SMALL_MAX < size <= MEDIUM_MAX),
+// reused without g_arena_lock. Cached blocks stay in_use in the arena, so
+// they don't coalesce until a full bin flushes half of itself back.
+void* tls_alloc_medium(size_t size);   // nullptr on miss
+bool  tls_free_medium(void* ptr);      // false if the block isn't cacheable
+
+// Fill this thread's cache for size (<= MEDIUM_MAX) with up to count blocks,
+// capped at the cache's own limit, so the first allocations of that size
+// are hits. Medium blocks get their pages faulted in. Returns blocks added.
+size_t tls_warmup(size_t size, size_t count);
+
+// Object caches (objcache.cpp) keep per-thread runs and free lists in the
+// same shape as size classes; blocks link through layout.link_offset.
+void* tls_obj_alloc(uint32_t id, uint32_t gen, const RunLayout& layout);
+void  tls_obj_free(uint32_t id, uint32_t gen, void* obj);
+void  tls_obj_flush(uint32_t id);   // return this thread's slot to the runs
+
+// Give back everything this thread holds: cached blocks to their runs,
+// the medium cache to the arena, and its runs to the orphan ring as at
+// thread exit. Used when the thread moves to another NUMA node.
+void tls_flush();
+
+// background only: drain retired runs of every live thread (skipping
+// threads that are busy refilling) and the runs orphaned by exited
+// threads; unmap the ones that emptied. Returns runs unmapped.
+size_t tls_reclaim();
+
+} // namespace ma
@@ -0,0 +1,214 @@
+#include "trace.h"
+#include "platform.h"
+#include "threading.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+namespace ma {
+
+std::atomic<bool> g_trace_on{false};
+
+#if MA_ENABLE_TRACE
+
+static constexpr uint32_t TRACE_BLOCK_EVENTS = 1024;   // 32 KiB of events
+
+// A block is filled by exactly one thread. Full blocks move to the writer
+// queue and come back through the pool. Blocks still being filled when the
+// trace stops are written up to their published count and left with their
+// thread, which recycles them once it notices the generation changed.
+struct TraceBlock {
+    TraceBlock*           next;        // queue / pool / live link, under g_trace_lock
+    uint32_t              tid;
+    uint32_t              gen;
+    std::atomic<uint32_t> count;
+    TraceEvent            events[TRACE_BLOCK_EVENTS];
+};
+
+static std::mutex              g_trace_lock;
+static std::condition_variable g_trace_cv;
+static TraceBlock*             g_queue      = nullptr;   // full, awaiting write (LIFO)
+static TraceBlock*             g_pool       = nullptr;   // recycled, empty
+static TraceBlock*             g_live       = nullptr;   // owned by a thread
+static bool                    g_stop       = false;
+static FILE*                   g_file       = nullptr;
+static std::thread             g_writer;
+static std::atomic<uint32_t>   g_trace_gen{0};
+
+static thread_local TraceBlock* tl_block = nullptr;
+
+static void list_remove(TraceBlock** head, TraceBlock* b) {
+    for (TraceBlock** p = head; *p; p = &(*p)->next) {
+        if (*p == b) { *p = b->next; return; }
+    }
+}
+
+static void write_block(TraceBlock* b, uint32_t count) {
+    if (!count) return;
+    TraceChunkHeader ch{b->tid, count};
+    fwrite(&ch, sizeof(ch), 1, g_file);
+    fwrite(b->events, sizeof(TraceEvent), count, g_file);
+}
+
+// caller holds g_trace_lock
+static void retire_locked(TraceBlock* b) {
+    if (b->gen == g_trace_gen.load(std::memory_order_relaxed)) {
+        list_remove(&g_live, b);
+        b->next = g_queue;
+        g_queue = b;
+        g_trace_cv.notify_one();
+    } else {
+        // already flushed by trace_stop — only we still reference it
+        b->next = g_pool;
+        g_pool  = b;
+    }
+}
+
+// slow path: no block yet, block full, or trace restarted since we got it
+static TraceBlock* block_rotate(TraceBlock* old) {
+    std::lock_guard<std::mutex> lock(g_trace_lock);
+
+    if (old) retire_locked(old);
+    if (!g_trace_on.load(std::memory_order_relaxed)) return nullptr;
+
+    TraceBlock* b = g_pool;
+    if (b) {
+        g_pool = b->next;
+    } else {
+        b = static_cast<TraceBlock*>(platform::vm_alloc(sizeof(TraceBlock)));
+        if (!b) return nullptr;
+    }
+
+    b->tid = platform::thread_id();
+    b->gen = g_trace_gen.load(std::memory_order_relaxed);
+    b->count.store(0, std::memory_order_relaxed);
+    b->next = g_live;
+    g_live  = b;
+    return b;
+}
+
+struct TraceReaper {
+    ~TraceReaper() {
+        if (!tl_block) return;
+        std::lock_guard<std::mutex> lock(g_trace_lock);
+        retire_locked(tl_block);
+        tl_block = nullptr;
+    }
+};
+
+void trace_record(TraceOp op, const void* ptr, const void* old_ptr, size_t size,
+                  uint64_t ts_ns) {
+    TraceBlock* b = tl_block;
+    if (!b || b->gen != g_trace_gen.load(std::memory_order_relaxed) ||
+        b->count.load(std::memory_order_relaxed) == TRACE_BLOCK_EVENTS) {
+        static thread_local TraceReaper reaper;
+        (void)reaper;
+
+        b = tl_block = block_rotate(b);
+        if (!b) return;
+    }
+
+    uint32_t    n = b->count.load(std::memory_order_relaxed);
+    TraceEvent& e = b->events[n];
+    e.ts_ns   = ts_ns;
+    e.ptr     = reinterpret_cast<uint64_t>(ptr);
+    e.old_ptr = reinterpret_cast<uint64_t>(old_ptr);
+    e.size_op = trace_pack(op, size);
+    b->count.store(n + 1, std::memory_order_release);
+}
+
+static void writer_main() {
+    std::unique_lock<std::mutex> lock(g_trace_lock);
+    for (;;) {
+        // timed like the background thread's: the untimed wait needs a
+        // newer libstdc++ at run time than the rest of the library
+        if (!g_trace_cv.wait_for(lock, std::chrono::seconds(1),
+                                 [] { return g_queue || g_stop; }))
+            continue;
+
+        TraceBlock* batch = g_queue;
+        g_queue = nullptr;
+        lock.unlock();
+
+        for (TraceBlock* b = batch; b; b = b->next)
+            write_block(b, b->count.load(std::memory_order_acquire));
+
+        lock.lock();
+        while (batch) {
+            TraceBlock* next = batch->next;
+            batch->next = g_pool;
+            g_pool      = batch;
+            batch       = next;
+        }
+        if (g_stop && !g_queue) return;
+    }
+}
+
+bool trace_start(const char* path) {
+    if (single_threaded()) return false;   // the writer is a second thread
+
+    std::lock_guard<std::mutex> lock(g_trace_lock);
+    if (g_file) return false;
+
+    g_file = fopen(path, "wb");
+    if (!g_file) return false;
+
+    TraceFileHeader hdr{TRACE_MAGIC, TRACE_VERSION, sizeof(TraceEvent)};
+    fwrite(&hdr, sizeof(hdr), 1, g_file);
+
+    // flush and join the writer if the process exits mid-trace
+    static bool exit_hook = (std::atexit(trace_stop), true);
+    (void)exit_hook;
+
+    g_stop = false;
+    g_trace_gen.fetch_add(1, std::memory_order_relaxed);
+    g_writer = std::thread(writer_main);
+    g_trace_on.store(true, std::memory_order_release);
+    return true;
+}
+
+void trace_stop() {
+    if (!g_trace_on.exchange(false)) return;
+
+    {
+        std::lock_guard<std::mutex> lock(g_trace_lock);
+        g_stop = true;
+        g_trace_cv.notify_one();
+    }
+    g_writer.join();
+
+    std::lock_guard<std::mutex> lock(g_trace_lock);
+
+    // partial blocks: write what has been published, leave them with their
+    // owners — a record racing with stop may land past the snapshot and is lost
+    g_trace_gen.fetch_add(1, std::memory_order_relaxed);
+    for (TraceBlock* b = g_live; b; b = b->next)
+        write_block(b, b->count.load(std::memory_order_acquire));
+    g_live = nullptr;
+
+    // blocks retired after the writer exited
+    while (g_queue) {
+        TraceBlock* b = g_queue;
+        g_queue = b->next;
+        write_block(b, b->count.load(std::memory_order_acquire));
+        b->next = g_pool;
+        g_pool  = b;
+    }
+
+    fclose(g_file);
+    g_file = nullptr;
+}
+
+#else
+
+bool     trace_start(const char*) { return false; }
+void     trace_stop() {}
+void     trace_record(TraceOp, const void*, const void*, size_t, uint64_t) {}
+
+#endif
+
+} // namespace ma
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "platform.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+
+#ifndef MA_ENABLE_TRACE
+#define MA_ENABLE_TRACE 0
+#endif
+
+namespace ma {
+
+// ── Trace file format ─────────────────────────────────────────────────────────
+// TraceFileHeader, then any number of chunks in arrival order:
+//   TraceChunkHeader { tid, count } followed by count TraceEvents
+// events within a chunk are in program order for that thread; timestamps
+// are CLOCK_MONOTONIC ns and comparable across threads
+//
+// shared with the replay tool (bench/replay.cpp), so keep it POD
+
+static constexpr uint64_t TRACE_MAGIC   = 0x4543415254414DULL;   // "MATRACE"
+static constexpr uint32_t TRACE_VERSION = 1;
+
+enum TraceOp : uint8_t {
+    TRACE_MALLOC  = 1,   // ptr = result, size = request
+    TRACE_FREE    = 2,   // ptr = freed pointer
+    TRACE_REALLOC = 3,   // ptr = result, old_ptr = input, size = request
+};
+
+struct TraceFileHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t event_size;
+};
+
+struct TraceChunkHeader {
+    uint32_t tid;
+    uint32_t count;
+};
+
+// 32 bytes — op lives in the top byte of size_op
+struct TraceEvent {
+    uint64_t ts_ns;
+    uint64_t ptr;
+    uint64_t old_ptr;
+    uint64_t size_op;
+};
+
+static_assert(sizeof(TraceEvent) == 32, "TraceEvent layout is part of the file format");
+
+inline uint64_t trace_pack(TraceOp op, size_t size) {
+    return (uint64_t(op) << 56) | (uint64_t(size) & ((uint64_t(1) << 56) - 1));
+}
+
+inline TraceOp trace_op(const TraceEvent& e)   { return static_cast<TraceOp>(e.size_op >> 56); }
+inline size_t  trace_size(const TraceEvent& e) { return e.size_op & ((uint64_t(1) << 56) - 1); }
+
+// ── Recording ─────────────────────────────────────────────────────────────────
+// one buffer per thread; full buffers are handed to a background writer
+
+extern std::atomic<bool> g_trace_on;
+
+bool     trace_start(const char* path);
+void     trace_stop();
+void     trace_record(TraceOp op, const void* ptr, const void* old_ptr, size_t size,
+                      uint64_t ts_ns);
+
+inline void trace_event(TraceOp op, const void* ptr, const void* old_ptr, size_t size) {
+#if MA_ENABLE_TRACE
+    if (__builtin_expect(g_trace_on.load(std::memory_order_relaxed), 0))
+        trace_record(op, ptr, old_ptr, size, platform::monotonic_ns());
+#else
+    (void)op; (void)ptr; (void)old_ptr; (void)size;
+#endif
+}
+
+// A realloc may free its input, and another thread's malloc may then get
+// the address and record it before the realloc returns. Stamp the realloc
+// before the call (0 while tracing is off) and record it with
+// trace_event_at, so its free of old_ptr sorts first.
+inline uint64_t trace_stamp() {
+#if MA_ENABLE_TRACE
+    if (__builtin_expect(g_trace_on.load(std::memory_order_relaxed), 0))
+        return platform::monotonic_ns();
+#endif
+    return 0;
+}
+
+inline void trace_event_at(uint64_t ts_ns, TraceOp op, const void* ptr, const void* old_ptr,
+                           size_t size) {
+#if MA_ENABLE_TRACE
+    if (__builtin_expect(ts_ns != 0, 0)) trace_record(op, ptr, old_ptr, size, ts_ns);
+#else
+    (void)ts_ns; (void)op; (void)ptr; (void)old_ptr; (void)size;
+#endif
+}
+
+} // namespace ma
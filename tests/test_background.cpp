@@ -0,0 +1,110 @@
+#include "../include/memalloc/memalloc.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// poll until pred holds or ~5s pass — the background thread runs on its own clock
+template <typename Pred>
+static bool eventually(Pred pred) {
+    for (int i = 0; i < 500; i++) {
+        if (pred()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return pred();
+}
+
+static MA_EventStats events() {
+    MA_EventStats e;
+    ma_event_stats(&e);
+    return e;
+}
+
+TEST(Background, StartStop) {
+    MA_BackgroundConfig bad = {0, 0};
+    EXPECT_EQ(ma_background_start(&bad), -1);
+
+    ASSERT_EQ(ma_background_start(nullptr), 0);
+    EXPECT_EQ(ma_background_start(nullptr), -1);
+    ma_background_stop();
+    ma_background_stop();
+}
+
+TEST(Background, RetiredRunsAreReused) {
+    // a full pass over several runs, freed, then again: the second pass
+    // should come out of the same runs instead of mapping new ones
+    const int N = 20000;
+    std::vector<void*> ptrs(N);
+    for (int i = 0; i < N; i++) ptrs[i] = ma_malloc(96);
+    for (int i = 0; i < N; i++) ma_free(ptrs[i]);
+
+    uint64_t mapped = events().runs_mapped;
+    for (int i = 0; i < N; i++) ptrs[i] = ma_malloc(96);
+    EXPECT_EQ(events().runs_mapped, mapped);
+    for (int i = 0; i < N; i++) ma_free(ptrs[i]);
+}
+
+TEST(Background, PurgesDecayedArenaMemory) {
+    const size_t SZ = 8 << 20;
+    void* p = ma_malloc(SZ);
+    ASSERT_NE(p, nullptr);
+    memset(p, 0xAB, SZ);
+    ma_free(p);
+
+    uint64_t before = events().purged_bytes;
+    MA_BackgroundConfig cfg = {1, 0};
+    ASSERT_EQ(ma_background_start(&cfg), 0);
+    EXPECT_TRUE(eventually([&] { return events().purged_bytes - before >= SZ / 2; }));
+    ma_background_stop();
+
+    // purged pages are still mapped and usable
+    p = ma_malloc(SZ);
+    ASSERT_NE(p, nullptr);
+    memset(p, 0xCD, SZ);
+    EXPECT_EQ(static_cast<unsigned char*>(p)[SZ - 1], 0xCD);
+    ma_free(p);
+}
+
+TEST(Background, ReclaimsOrphanedRuns) {
+    // allocate on a thread that exits, free from this one: the runs are
+    // orphaned and only the background thread can unmap them
+    const int N = 20000;
+    std::vector<void*> ptrs(N);
+    std::thread owner([&]() {
+        for (int i = 0; i < N; i++) ptrs[i] = ma_malloc(200);
+    });
+    owner.join();
+    for (int i = 0; i < N; i++) ma_free(ptrs[i]);
+
+    uint64_t before = events().runs_unmapped;
+    MA_BackgroundConfig cfg = {1, 1000};
+    ASSERT_EQ(ma_background_start(&cfg), 0);
+    EXPECT_TRUE(eventually([&] { return events().runs_unmapped > before; }));
+    ma_background_stop();
+}
+
+TEST(Background, StatsStayExactWhileFolding) {
+    MA_BackgroundConfig cfg = {1, 1000};
+    ASSERT_EQ(ma_background_start(&cfg), 0);
+
+    MA_Stats before;
+    ma_stats(&before);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([]() {
+            for (int i = 0; i < 100; i++) ma_free(ma_malloc(24));
+        });
+    }
+    for (auto& th : threads) th.join();
+
+    MA_Stats after;
+    ma_stats(&after);
+    EXPECT_EQ(after.bytes_requested - before.bytes_requested, 8u * 100 * 24);
+    EXPECT_EQ(after.bytes_allocated, before.bytes_allocated);
+
+    ma_background_stop();
+    ma_stats(&after);
+    EXPECT_EQ(after.bytes_requested - before.bytes_requested, 8u * 100 * 24);
+}
@@ -1,8 +1,21 @@
 #include "../include/memalloc/memalloc.h"
 #include <gtest/gtest.h>
+#include <cerrno>
 #include <cstring>
+#include <thread>
 #include <vector>
 
+// this suite isn't built with ENABLE_SINGLE_THREADED (test_single.cpp is),
+// and the mode has no runtime switch
+TEST(Basic, ThreadSingleIsBuildTimeOnly) {
+    size_t single = 1;
+    ASSERT_EQ(ma_ctl("thread.single", &single, nullptr), 0);
+    EXPECT_EQ(single, 0u);
+
+    size_t one = 1;
+    EXPECT_EQ(ma_ctl("thread.single", nullptr, &one), EPERM);
+}
+
 TEST(Basic, MallocFree) {
     void* p = ma_malloc(64);
     ASSERT_NE(p, nullptr);
@@ -62,4 +75,24 @@ TEST(Basic, ManySmallAllocs) {
         ptrs.push_back(p);
     }
     for (void* p : ptrs) ma_free(p);
-}
\ No newline at end of file
+}
+TEST(Basic, ForeignPointerIgnored) {
+    // memory the allocator never handed out must not be misclassified
+    static char buf[4096];
+    ma_free(buf + 128);
+    EXPECT_EQ(ma_realloc(buf + 128, 64), nullptr);
+}
+
+TEST(Basic, TierClassificationAcrossRegions) {
+    // force extra arena regions; frees must find their region without a list walk
+    std::vector<void*> big;
+    for (int i = 0; i < 3; i++) {
+        void* p = ma_malloc(48 * 1024 * 1024);
+        ASSERT_NE(p, nullptr);
+        big.push_back(p);
+    }
+    void* small = ma_malloc(24);
+    ASSERT_NE(small, nullptr);
+    for (void* p : big) ma_free(p);
+    ma_free(small);
+}
@@ -44,4 +44,31 @@ TEST(Coalesce, FragmentationMetrics) {
 
     for (int i = 1; i < 50; i += 2)
         ma_free(ptrs[i]);
-}
\ No newline at end of file
+}
+TEST(Coalesce, MediumCacheReusesSameSize) {
+    // same-thread free + same-size malloc comes straight back from the
+    // thread's medium cache, without going through the arena free list
+    void* a = ma_malloc(3000);
+    ASSERT_NE(a, nullptr);
+    ma_free(a);
+    void* b = ma_malloc(3000);
+    EXPECT_EQ(a, b);
+    ma_free(b);
+}
+
+TEST(Coalesce, MediumCacheFlushesOnOverflow) {
+    // far more same-bin frees than a bin holds: the overflow goes back to
+    // the arena free list
+    const int N = 64;
+    std::vector<void*> ptrs;
+    for (int i = 0; i < N; i++) ptrs.push_back(ma_malloc(2048));
+
+    MA_Stats before;
+    ma_stats(&before);
+    for (void* p : ptrs) ma_free(p);
+
+    MA_Stats after;
+    ma_stats(&after);
+    // a bin keeps at most 16 blocks
+    EXPECT_GE(after.bytes_free - before.bytes_free, size_t(N - 16) * 2048);
+}
@@ -0,0 +1,145 @@
+#include "../include/memalloc/memalloc.h"
+#include <gtest/gtest.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+static MA_EventStats events() {
+    MA_EventStats e;
+    ma_event_stats(&e);
+    return e;
+}
+
+static size_t ctl_get(const char* name) {
+    size_t v = 0;
+    EXPECT_EQ(ma_ctl(name, &v, nullptr), 0) << name;
+    return v;
+}
+
+static void ctl_set(const char* name, size_t v) {
+    ASSERT_EQ(ma_ctl(name, nullptr, &v), 0) << name;
+}
+
+TEST(Ctl, NamesAndErrors) {
+    size_t v = 0;
+    EXPECT_EQ(ma_ctl("no.such.setting", &v, nullptr), ENOENT);
+    EXPECT_EQ(ma_ctl(nullptr, &v, nullptr), ENOENT);
+
+    EXPECT_GE(ctl_get("arena.count"), 1u);   // one per NUMA node
+    EXPECT_EQ(ctl_get("slab.run_size"), 65536u);
+    v = 2;
+    EXPECT_EQ(ma_ctl("arena.count", nullptr, &v), EPERM);
+
+    size_t old = ctl_get("tcache.max");
+    size_t bad = 1 << 20;
+    EXPECT_EQ(ma_ctl("tcache.max", nullptr, &bad), EINVAL);
+    EXPECT_EQ(ctl_get("tcache.max"), old);
+
+    bad = 4096;   // nonzero but below 128KB
+    EXPECT_EQ(ma_ctl("arena.huge_threshold", nullptr, &bad), EINVAL);
+    bad = 3 << 20;
+    EXPECT_EQ(ma_ctl("arena.region_size", nullptr, &bad), EINVAL);
+
+    // old value comes back from the same call that writes
+    size_t next = 32, prev = 0;
+    ASSERT_EQ(ma_ctl("tcache.max", &prev, &next), 0);
+    EXPECT_EQ(prev, old);
+    EXPECT_EQ(ctl_get("tcache.max"), 32u);
+    ctl_set("tcache.max", old);
+}
+
+TEST(Ctl, TcacheMaxZeroBypassesCache) {
+    size_t old = ctl_get("tcache.max");
+    ctl_set("tcache.max", 0);
+
+    // with nothing cached, every malloc after a free is a refill
+    std::thread t([]() {
+        MA_EventStats before = events();
+        for (int i = 0; i < 100; i++) ma_free(ma_malloc(64));
+        EXPECT_GE(events().tcache_refills - before.tcache_refills, 100u);
+    });
+    t.join();
+
+    ctl_set("tcache.max", old);
+    std::thread t2([]() {
+        MA_EventStats before = events();
+        for (int i = 0; i < 100; i++) ma_free(ma_malloc(64));
+        EXPECT_LE(events().tcache_refills - before.tcache_refills, 1u);
+    });
+    t2.join();
+}
+
+TEST(Ctl, HugeThresholdMapsAndUnmaps) {
+    ctl_set("arena.huge_threshold", 1 << 20);
+
+    MA_Stats s0;
+    ma_stats(&s0);
+    MA_EventStats before = events();
+
+    void* p = ma_malloc(3 << 20);
+    ASSERT_NE(p, nullptr);
+    memset(p, 0x5A, 3 << 20);
+    EXPECT_EQ(events().regions_mapped, before.regions_mapped + 1);
+
+    // realloc within the tier keeps the contents
+    void* q = ma_realloc(p, 4 << 20);
+    ASSERT_NE(q, nullptr);
+    EXPECT_EQ(static_cast<unsigned char*>(q)[(3 << 20) - 1], 0x5A);
+    ma_free(q);
+
+    // neither block ever joined the shared free list
+    MA_Stats s1;
+    ma_stats(&s1);
+    EXPECT_EQ(s1.bytes_free, s0.bytes_free);
+    EXPECT_EQ(s1.bytes_allocated, s0.bytes_allocated);
+
+    ctl_set("arena.huge_threshold", 0);
+}
+
+TEST(Ctl, StatsDisabledStopsEvents) {
+    ctl_set("stats.enabled", 0);
+    MA_EventStats before = events();
+    std::thread t([]() {
+        for (int i = 0; i < 100; i++) ma_free(ma_malloc(8 * (i % 64 + 1)));
+    });
+    t.join();
+    EXPECT_EQ(events().tcache_refills, before.tcache_refills);
+    EXPECT_EQ(events().runs_mapped, before.runs_mapped);
+    ctl_set("stats.enabled", 1);
+}
+
+TEST(Ctl, MediumCacheCanBeSwitchedOff) {
+    size_t old = ctl_get("tcache.medium_bytes");
+    ctl_set("tcache.medium_bytes", 0);
+
+    // the free goes straight back to the arena's free list
+    void* p = ma_malloc(4000);
+    MA_Stats s0;
+    ma_stats(&s0);
+    ma_free(p);
+    MA_Stats s1;
+    ma_stats(&s1);
+    EXPECT_GE(s1.bytes_free, s0.bytes_free + 4000);
+
+    ctl_set("tcache.medium_bytes", old);
+}
+
+TEST(Ctl, BackgroundToggle) {
+    ctl_set("background.interval_ms", 5);
+    ctl_set("background.enabled", 1);
+    EXPECT_EQ(ctl_get("background.enabled"), 1u);
+    ctl_set("background.enabled", 0);
+    EXPECT_EQ(ctl_get("background.enabled"), 0u);
+
+    size_t zero = 0;
+    EXPECT_EQ(ma_ctl("background.interval_ms", nullptr, &zero), EINVAL);
+}
+
+// ctest runs this test alone with MEMALLOC_CONF set (see CMakeLists.txt)
+TEST(Ctl, EnvironmentAppliedAtInit) {
+    const char* conf = std::getenv("MEMALLOC_CONF");
+    if (!conf) GTEST_SKIP() << "MEMALLOC_CONF not set";
+    EXPECT_EQ(ctl_get("arena.region_size"), size_t(32) << 20);
+}
@@ -0,0 +1,142 @@
+#include "../include/memalloc/memalloc.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// a reclaim pass only advances the epoch one step, and blocks need two
+static size_t reclaim_all(size_t passes = 4) {
+    size_t freed = 0;
+    for (size_t i = 0; i < passes; i++) freed += ma_epoch_reclaim();
+    return freed;
+}
+
+TEST(Epoch, BlocksWaitForReaders) {
+    reclaim_all();   // whatever earlier tests left
+
+    std::atomic<int> stage{0};
+    std::thread reader([&]() {
+        ma_epoch_enter();
+        stage = 1;
+        while (stage.load() != 2) std::this_thread::yield();
+        ma_epoch_exit();
+        stage = 3;
+    });
+    while (stage.load() != 1) std::this_thread::yield();
+
+    for (int i = 0; i < 10; i++) ma_free_deferred(ma_malloc(64));
+    EXPECT_EQ(reclaim_all(), 0u);
+
+    stage = 2;
+    while (stage.load() != 3) std::this_thread::yield();
+    EXPECT_EQ(reclaim_all(), 10u);
+    reader.join();
+}
+
+TEST(Epoch, NestedSectionsAndOwnSection) {
+    reclaim_all();
+
+    ma_epoch_enter();
+    ma_epoch_enter();
+    ma_free_deferred(ma_malloc(100));
+    ma_epoch_exit();
+    // still inside the outer section: this thread holds the epoch itself
+    EXPECT_EQ(reclaim_all(), 0u);
+    ma_epoch_exit();
+    EXPECT_EQ(reclaim_all(), 1u);
+}
+
+TEST(Epoch, ReclaimedBlockGoesBackToCache) {
+    reclaim_all();
+
+    void* p = ma_malloc(48);
+    ASSERT_NE(p, nullptr);
+    ma_free_deferred(p);
+    EXPECT_EQ(reclaim_all(), 1u);
+    EXPECT_EQ(ma_malloc(48), p);
+    ma_free(p);
+}
+
+TEST(Epoch, ExitedThreadBlocksAreReclaimedElsewhere) {
+    reclaim_all();
+
+    std::thread t([]() {
+        for (int i = 0; i < 5; i++) ma_free_deferred(ma_malloc(200));
+    });
+    t.join();
+    EXPECT_EQ(reclaim_all(), 5u);
+}
+
+// Treiber stack: poppers retire nodes that concurrent poppers and readers
+// may still be looking at. Under TSan an early reuse shows up as a race
+// on value/check; otherwise as a mismatch.
+struct Node {
+    std::atomic<Node*> next;
+    uint64_t           value;
+    uint64_t           check;   // ~value
+};
+
+TEST(Epoch, LockFreeStackStress) {
+    static constexpr int WRITERS = 3;
+    static constexpr int READERS = 2;
+    static constexpr int OPS     = 20000;
+
+    std::atomic<Node*> head{nullptr};
+    auto push = [&](uint64_t v) {
+        Node* n  = static_cast<Node*>(ma_malloc(sizeof(Node)));
+        n->value = v;
+        n->check = ~v;
+        Node* h  = head.load(std::memory_order_relaxed);
+        do n->next.store(h, std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(h, n, std::memory_order_release,
+                                           std::memory_order_relaxed));
+    };
+    for (int i = 0; i < 64; i++) push(i);
+
+    std::atomic<bool> done{false};
+    std::atomic<long> bad{0};
+
+    std::vector<std::thread> threads;
+    for (int w = 0; w < WRITERS; w++) {
+        threads.emplace_back([&, w]() {
+            for (int i = 0; i < OPS; i++) {
+                ma_epoch_enter();
+                Node* h = head.load(std::memory_order_acquire);
+                while (h && !head.compare_exchange_weak(
+                                h, h->next.load(std::memory_order_relaxed),
+                                std::memory_order_acquire, std::memory_order_acquire)) {}
+                ma_epoch_exit();
+
+                if (h) {
+                    if (h->check != ~h->value) bad++;
+                    ma_free_deferred(h);
+                }
+                push(uint64_t(w) << 32 | uint64_t(i));
+            }
+        });
+    }
+    for (int r = 0; r < READERS; r++) {
+        threads.emplace_back([&]() {
+            while (!done.load(std::memory_order_relaxed)) {
+                ma_epoch_enter();
+                Node* n = head.load(std::memory_order_acquire);
+                for (int k = 0; n && k < 16; k++) {
+                    if (n->check != ~n->value) bad++;
+                    n = n->next.load(std::memory_order_acquire);
+                }
+                ma_epoch_exit();
+            }
+        });
+    }
+    for (int w = 0; w < WRITERS; w++) threads[w].join();
+    done = true;
+    for (size_t t = WRITERS; t < threads.size(); t++) threads[t].join();
+
+    EXPECT_EQ(bad.load(), 0);
+
+    while (Node* n = head.load()) {
+        head = n->next.load();
+        ma_free(n);
+    }
+    reclaim_all();
+}
@@ -0,0 +1,87 @@
+#include "../include/memalloc/fast.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+struct Node {
+    Node* next;
+    int   value[5];
+};
+
+TEST(Fast, AllocFreeRoundTrip) {
+    std::vector<Node*> nodes;
+    for (int i = 0; i < 1000; i++) {
+        Node* n = static_cast<Node*>(ma::alloc<sizeof(Node)>());
+        ASSERT_NE(n, nullptr);
+        n->value[0] = i;
+        nodes.push_back(n);
+    }
+    for (int i = 0; i < 1000; i++) EXPECT_EQ(nodes[i]->value[0], i);
+    for (Node* n : nodes) ma::free<sizeof(Node)>(n);
+
+    // a just-freed block comes straight back
+    void* a = ma::alloc<sizeof(Node)>();
+    ma::free<sizeof(Node)>(a);
+    EXPECT_EQ(ma::alloc<sizeof(Node)>(), a);
+    ma::free<sizeof(Node)>(a);
+}
+
+TEST(Fast, StatsStayExact) {
+    ma_free(ma_malloc(64));   // make sure this thread has a cache and a slot
+
+    MA_Stats s0;
+    ma_stats(&s0);
+    std::vector<void*> ptrs;
+    for (int i = 0; i < 100; i++) ptrs.push_back(ma::alloc<60>());
+
+    MA_Stats s1;
+    ma_stats(&s1);
+    EXPECT_EQ(s1.bytes_requested - s0.bytes_requested, 100u * 60);
+    EXPECT_EQ(s1.bytes_allocated - s0.bytes_allocated, 100u * 64);
+    EXPECT_EQ(s1.slab_in_use - s0.slab_in_use, 100u);
+
+    for (void* p : ptrs) ma::free<60>(p);
+    MA_Stats s2;
+    ma_stats(&s2);
+    EXPECT_EQ(s2.bytes_allocated, s0.bytes_allocated);
+    EXPECT_EQ(s2.slab_in_use, s0.slab_in_use);
+}
+
+TEST(Fast, MixesWithMallocFreeAndLargeSizes) {
+    void* a = ma::alloc<100>();
+    void* b = ma_malloc(100);
+    ma_free(a);
+    ma::free<104>(b);   // same class as 100
+
+    // over 512 bytes goes through ma_malloc
+    char* big = static_cast<char*>(ma::alloc<4096>());
+    ASSERT_NE(big, nullptr);
+    memset(big, 0x33, 4096);
+    ma::free<4096>(big);
+}
+
+TEST(Fast, FreshThreadAndCrossThreadFree) {
+    std::vector<void*> ptrs;
+    std::thread t([&]() {
+        // nothing cached yet: the first call takes the slow path
+        for (int i = 0; i < 500; i++) ptrs.push_back(ma::alloc<32>());
+    });
+    t.join();
+    for (void* p : ptrs) ma::free<32>(p);
+}
+
+TEST(Fast, RespectsTcacheMax) {
+    size_t old = 0, zero = 0;
+    ASSERT_EQ(ma_ctl("tcache.max", &old, &zero), 0);
+
+    MA_EventStats e0;
+    ma_event_stats(&e0);
+    for (int i = 0; i < 50; i++) ma::free<24>(ma::alloc<24>());
+    MA_EventStats e1;
+    ma_event_stats(&e1);
+    // nothing is cached on free, so every alloc but the first refills
+    EXPECT_GE(e1.tcache_refills - e0.tcache_refills, 49u);
+
+    ASSERT_EQ(ma_ctl("tcache.max", nullptr, &old), 0);
+}
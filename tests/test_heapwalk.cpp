@@ -0,0 +1,144 @@
+#include "../include/memalloc/memalloc.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+struct Found {
+    void*  target;
+    int    tier   = -1;
+    size_t size   = 0;
+    int    in_use = -1;
+};
+
+// the extent covering target: an arena block starting at it, or the live
+// blocks of the (64KB-aligned) run holding it
+static int find_extent(const MA_HeapExtent* x, void* arg) {
+    Found* f = static_cast<Found*>(arg);
+
+    char* t = static_cast<char*>(f->target);
+    char* a = static_cast<char*>(x->addr);
+    bool  same_run = (reinterpret_cast<uintptr_t>(t) >> 16) == (reinterpret_cast<uintptr_t>(a) >> 16);
+    bool  hit = (x->tier == MA_TIER_SMALL || x->tier == MA_TIER_OBJECT)
+                    ? x->in_use && same_run && t >= a && (t - a) % x->size == 0
+                    : a == t;
+    if (hit && f->tier < 0) {
+        f->tier   = x->tier;
+        f->size   = x->size;
+        f->in_use = x->in_use;
+    }
+    return 0;
+}
+
+static Found walk_for(void* p) {
+    Found f;
+    f.target = p;
+    EXPECT_EQ(ma_heap_walk(find_extent, &f), 0);
+    return f;
+}
+
+TEST(HeapWalk, ReportsLiveBlocksByTier) {
+    void* small = ma_malloc(64);
+    void* large = ma_malloc(200000);   // never medium-cached
+    ASSERT_NE(small, nullptr);
+    ASSERT_NE(large, nullptr);
+
+    Found fs = walk_for(small);
+    EXPECT_EQ(fs.tier, MA_TIER_SMALL);
+    EXPECT_EQ(fs.size, 64u);
+    EXPECT_EQ(fs.in_use, 1);
+
+    Found fl = walk_for(large);
+    EXPECT_EQ(fl.tier, MA_TIER_ARENA);
+    EXPECT_GE(fl.size, 200000u);
+    EXPECT_EQ(fl.in_use, 1);
+
+    ma_free(large);
+    Found freed = walk_for(large);
+    // coalesced into its free neighbour, or a free block of its own
+    if (freed.tier >= 0) {
+        EXPECT_EQ(freed.in_use, 0);
+    }
+
+    ma_free(small);
+}
+
+static int stop_at_first(const MA_HeapExtent*, void* arg) {
+    ++*static_cast<int*>(arg);
+    return 7;
+}
+
+TEST(HeapWalk, CallbackCanStopTheWalk) {
+    void* p = ma_malloc(32);
+    int   calls = 0;
+    EXPECT_EQ(ma_heap_walk(stop_at_first, &calls), 7);
+    EXPECT_EQ(calls, 1);
+    ma_free(p);
+}
+
+TEST(HeapWalk, HugeBlocksHaveTheirOwnTier) {
+    size_t old = 0, huge = 128 * 1024;
+    ASSERT_EQ(ma_ctl("arena.huge_threshold", &old, &huge), 0);
+
+    void* p = ma_malloc(300000);
+    ASSERT_NE(p, nullptr);
+    Found f = walk_for(p);
+    EXPECT_EQ(f.tier, MA_TIER_HUGE);
+    EXPECT_EQ(f.in_use, 1);
+    EXPECT_GE(f.size, 300000u);
+
+    ma_free(p);
+    EXPECT_EQ(walk_for(p).tier, -1);   // unmapped
+    ASSERT_EQ(ma_ctl("arena.huge_threshold", nullptr, &old), 0);
+}
+
+TEST(HeapWalk, SnapshotSummarizesRunsAndRegions) {
+    void* small = ma_malloc(200);
+    void* large = ma_malloc(100000);
+    ASSERT_NE(small, nullptr);
+    ASSERT_NE(large, nullptr);
+
+    size_t n = ma_heap_snapshot(nullptr, 0);
+    ASSERT_GT(n, 0u);
+    std::vector<MA_HeapSpan> spans(n + 16);
+    size_t got = ma_heap_snapshot(spans.data(), spans.size());
+    ASSERT_GE(got, n);
+    ASSERT_LE(got, spans.size());
+    spans.resize(got);
+
+    const MA_HeapSpan* run    = nullptr;
+    const MA_HeapSpan* region = nullptr;
+    for (const MA_HeapSpan& s : spans) {
+        char* b = static_cast<char*>(s.addr);
+        if (small >= b && small < b + s.size) run    = &s;
+        if (large >= b && large < b + s.size) region = &s;
+
+        EXPECT_LE(s.largest_free, s.free_bytes);
+        EXPECT_LE(s.live_bytes + s.free_bytes, s.size);
+    }
+    ASSERT_NE(run, nullptr);
+    EXPECT_EQ(run->tier, MA_TIER_SMALL);
+    EXPECT_EQ(run->block_size, 200u);
+    EXPECT_GE(run->live_bytes, 200u);
+    EXPECT_EQ(run->size, 65536u);
+
+    ASSERT_NE(region, nullptr);
+    EXPECT_EQ(region->tier, MA_TIER_ARENA);
+    EXPECT_EQ(region->block_size, 0u);
+    EXPECT_GE(region->live_bytes, 100000u);
+
+    ma_free(small);
+    ma_free(large);
+}
+
+TEST(HeapWalk, ObjectCacheRunsAreReported) {
+    MA_Cache* c = ma_cache_create(40, 0, nullptr, nullptr);
+    ASSERT_NE(c, nullptr);
+    void* obj = ma_cache_alloc(c);
+    ASSERT_NE(obj, nullptr);
+
+    Found f = walk_for(obj);
+    EXPECT_EQ(f.tier, MA_TIER_OBJECT);
+    EXPECT_EQ(f.in_use, 1);
+
+    ma_cache_free(c, obj);
+    ma_cache_destroy(c);
+}
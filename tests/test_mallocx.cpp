@@ -0,0 +1,145 @@
+#include "../include/memalloc/memalloc.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+static bool all_zero(const void* p, size_t n) {
+    const unsigned char* b = static_cast<const unsigned char*>(p);
+    for (size_t i = 0; i < n; i++)
+        if (b[i]) return false;
+    return true;
+}
+
+TEST(Mallocx, AlignedAndZeroed) {
+    for (size_t align : {16, 32, 64, 128, 4096}) {
+        for (size_t size : {1, 24, 100, 500, 3000, 70000}) {
+            // dirty a block of the same size first so reuse would show
+            void* dirty = ma_malloc(size);
+            memset(dirty, 0xCD, size);
+            ma_free(dirty);
+
+            void* p = ma_mallocx(size, MA_MALLOCX_ALIGN(align) | MA_MALLOCX_ZERO);
+            ASSERT_NE(p, nullptr) << size << " @" << align;
+            EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % align, 0u) << size << " @" << align;
+            EXPECT_TRUE(all_zero(p, size)) << size << " @" << align;
+            memset(p, 0xEE, size);
+
+            if (size % 2) ma_free(p);
+            else          ma_dallocx(p, 0);
+        }
+    }
+}
+
+TEST(Mallocx, InvalidFlagsFail) {
+    size_t arenas = 0;
+    ASSERT_EQ(ma_ctl("arena.count", &arenas, nullptr), 0);
+    EXPECT_EQ(ma_mallocx(64, MA_MALLOCX_ARENA(arenas)), nullptr);
+    EXPECT_EQ(ma_mallocx(64, MA_MALLOCX_LG_ALIGN(63)), nullptr);
+    EXPECT_EQ(ma_mallocx(0, 0), nullptr);
+}
+
+TEST(Mallocx, AlignZeroSetsNoFlag) {
+    static_assert(MA_MALLOCX_ALIGN(0) == 0, "alignment 0 is no flag");
+    void* p = ma_mallocx(100, MA_MALLOCX_ALIGN(0) | MA_MALLOCX_ZERO);
+    ASSERT_NE(p, nullptr);
+    EXPECT_EQ(static_cast<unsigned char*>(p)[99], 0);
+    ma_dallocx(p, 0);
+}
+
+static int find_tier(const MA_HeapExtent* x, void* arg) {
+    auto* q = static_cast<std::pair<void*, int>*>(arg);
+    if (x->addr == q->first && x->in_use) q->second = x->tier;
+    return 0;
+}
+
+TEST(Mallocx, ExplicitArenaTakesArenaBlocks) {
+    void* p = ma_mallocx(32, MA_MALLOCX_ARENA(0));
+    ASSERT_NE(p, nullptr);
+
+    std::pair<void*, int> q{p, -1};
+    ma_heap_walk(find_tier, &q);
+    EXPECT_EQ(q.second, MA_TIER_ARENA);
+    ma_dallocx(p, MA_MALLOCX_ARENA(0));
+}
+
+TEST(Mallocx, NoMoveResizesInPlaceOrFails) {
+    // small: anything up to the class size stays, a bigger class can't
+    void* s = ma_malloc(40);
+    ASSERT_NE(s, nullptr);
+    EXPECT_EQ(ma_rallocx(s, 16, MA_MALLOCX_NO_MOVE), s);
+    EXPECT_EQ(ma_rallocx(s, 40, MA_MALLOCX_NO_MOVE), s);
+    EXPECT_EQ(ma_rallocx(s, 48, MA_MALLOCX_NO_MOVE), nullptr);
+    ma_free(s);
+
+    // arena: shrinking frees the tail, growing takes it back
+    char* a = static_cast<char*>(ma_mallocx(20000, MA_MALLOCX_TCACHE_NONE));
+    ASSERT_NE(a, nullptr);
+    memset(a, 0x5A, 20000);
+    EXPECT_EQ(ma_rallocx(a, 8000, MA_MALLOCX_NO_MOVE), a);
+    EXPECT_EQ(ma_rallocx(a, 20000, MA_MALLOCX_NO_MOVE | MA_MALLOCX_ZERO), a);
+    EXPECT_EQ(a[7999], 0x5A);
+    EXPECT_TRUE(all_zero(a + 8000, 12000));
+
+    // too big to grow into: NULL, block untouched
+    EXPECT_EQ(ma_rallocx(a, size_t(1) << 40, MA_MALLOCX_NO_MOVE), nullptr);
+    EXPECT_EQ(a[0], 0x5A);
+
+    // an alignment the block doesn't have can't be had without moving
+    size_t misaligned = (reinterpret_cast<uintptr_t>(a) & 4095) ? 4096 : 8192;
+    if (reinterpret_cast<uintptr_t>(a) % misaligned) {
+        EXPECT_EQ(ma_rallocx(a, 20000, MA_MALLOCX_NO_MOVE | MA_MALLOCX_ALIGN(misaligned)), nullptr);
+    }
+    ma_dallocx(a, MA_MALLOCX_TCACHE_NONE);
+}
+
+TEST(Mallocx, RallocxMovesAndZeroesGrowth) {
+    unsigned char* p = static_cast<unsigned char*>(ma_mallocx(100, 0));
+    ASSERT_NE(p, nullptr);
+    memset(p, 0xAB, 100);
+
+    unsigned char* q = static_cast<unsigned char*>(
+        ma_rallocx(p, 5000, MA_MALLOCX_ZERO | MA_MALLOCX_ALIGN(256)));
+    ASSERT_NE(q, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(q) % 256, 0u);
+    for (int i = 0; i < 100; i++) ASSERT_EQ(q[i], 0xAB);
+    EXPECT_TRUE(all_zero(q + 100, 4900));
+
+    // NULL ptr allocates
+    void* r = ma_rallocx(nullptr, 64, MA_MALLOCX_ZERO);
+    ASSERT_NE(r, nullptr);
+    EXPECT_TRUE(all_zero(r, 64));
+    ma_free(r);
+    ma_free(q);
+}
+
+static MA_EventStats events() {
+    MA_EventStats e;
+    ma_event_stats(&e);
+    return e;
+}
+
+TEST(Mallocx, TcacheBypassFreesStraightToTheRun) {
+    const int N = 100;
+    std::vector<void*> blocks;
+    for (int i = 0; i < N; i++) blocks.push_back(ma_mallocx(72, MA_MALLOCX_TCACHE_NONE));
+
+    // counted before each thread exits, which flushes its cache
+    uint64_t plain = 0, bypass = 0;
+
+    // a plain free on another thread caches them there
+    std::thread([&]() {
+        MA_EventStats before = events();
+        for (int i = 0; i < N / 2; i++) ma_free(blocks[i]);
+        plain = events().remote_frees - before.remote_frees;
+    }).join();
+    EXPECT_EQ(plain, 0u);
+
+    // bypassing the cache pushes them onto the owner's run
+    std::thread([&]() {
+        MA_EventStats before = events();
+        for (int i = N / 2; i < N; i++) ma_dallocx(blocks[i], MA_MALLOCX_TCACHE_NONE);
+        bypass = events().remote_frees - before.remote_frees;
+    }).join();
+    EXPECT_EQ(bypass, uint64_t(N / 2));
+}
@@ -0,0 +1,166 @@
+#include "../include/memalloc/memalloc.h"
+#include "../include/memalloc/fast.h"
+#include <gtest/gtest.h>
+#include <cerrno>
+#include <thread>
+#include <vector>
+
+// ctest runs this suite a second time with MEMALLOC_CONF=arena.count:2;
+// the placement tests need that many nodes, real or simulated
+
+static size_t ctl_get(const char* name) {
+    size_t v = 0;
+    EXPECT_EQ(ma_ctl(name, &v, nullptr), 0) << name;
+    return v;
+}
+
+static void move_to(size_t node) {
+    ASSERT_EQ(ma_ctl("thread.node", nullptr, &node), 0);
+}
+
+static MA_EventStats events() {
+    MA_EventStats e;
+    ma_event_stats(&e);
+    return e;
+}
+
+// the span holding p
+static MA_HeapSpan span_of(void* p) {
+    std::vector<MA_HeapSpan> spans(ma_heap_snapshot(nullptr, 0) + 64);
+    spans.resize(ma_heap_snapshot(spans.data(), spans.size()));
+    for (const MA_HeapSpan& s : spans) {
+        char* b = static_cast<char*>(s.addr);
+        if (p >= b && p < b + s.size) return s;
+    }
+    ADD_FAILURE() << "no span holds " << p;
+    return MA_HeapSpan{};
+}
+
+static int extent_in_use(const MA_HeapExtent* x, void* arg) {
+    auto* q = static_cast<std::pair<void*, int>*>(arg);
+    if (x->addr == q->first) q->second = x->in_use;
+    return 0;
+}
+
+TEST(Numa, ThreadNodeIsAnArena) {
+    size_t count = ctl_get("arena.count");
+    ASSERT_GE(count, 1u);
+    EXPECT_LT(ctl_get("thread.node"), count);
+
+    size_t v = count;
+    EXPECT_EQ(ma_ctl("thread.node", nullptr, &v), EINVAL);
+    v = 1;
+    EXPECT_EQ(ma_ctl("arena.count", nullptr, &v), EPERM);   // fixed at init
+    EXPECT_EQ(ma_mallocx(64, MA_MALLOCX_ARENA(count)), nullptr);
+}
+
+TEST(Numa, ThreadsAllocateFromTheirNode) {
+    size_t count = ctl_get("arena.count");
+    if (count < 2) GTEST_SKIP() << "one node (set arena.count:2 to simulate two)";
+
+    for (size_t node = 0; node < 2; node++) {
+        std::thread([node]() {
+            move_to(node);
+            void* small   = ma_malloc(64);
+            void* large   = ma_malloc(200000);
+            void* aligned = ma_mallocx(1000, MA_MALLOCX_ARENA(node) | MA_MALLOCX_ALIGN(4096));
+            ASSERT_NE(small, nullptr);
+            ASSERT_NE(large, nullptr);
+            ASSERT_NE(aligned, nullptr);
+
+            EXPECT_EQ(span_of(small).node, node);
+            EXPECT_EQ(span_of(large).node, node);
+            EXPECT_EQ(span_of(aligned).node, node);
+
+            ma_free(small);
+            ma_free(large);
+            ma_free(aligned);
+        }).join();
+    }
+}
+
+TEST(Numa, ExplicitArenaPicksTheNode) {
+    if (ctl_get("arena.count") < 2) GTEST_SKIP() << "one node";
+
+    std::thread([]() {
+        move_to(0);
+        void* p = ma_mallocx(100, MA_MALLOCX_ARENA(1));
+        ASSERT_NE(p, nullptr);
+        EXPECT_EQ(span_of(p).node, 1u);
+        ma_free(p);
+    }).join();
+}
+
+TEST(Numa, FreesGoBackToTheOwningNode) {
+    if (ctl_get("arena.count") < 2) GTEST_SKIP() << "one node";
+
+    const int N = 64;
+    std::vector<void*> small, medium;
+    std::thread([&]() {
+        move_to(0);
+        for (int i = 0; i < N; i++) small.push_back(ma_malloc(72));
+        for (int i = 0; i < 4; i++) medium.push_back(ma_malloc(2000));
+    }).join();
+
+    uint64_t remote = 0;
+    std::thread([&]() {
+        move_to(1);
+        MA_EventStats before = events();
+        // not cached here: each goes to its run on node 0
+        for (void* p : small) ma_free(p);
+        remote = events().remote_frees - before.remote_frees;
+
+        // not medium-cached either: straight back to node 0's free list
+        for (void* p : medium) {
+            ma_free(p);
+            std::pair<void*, int> q{p, -1};
+            ma_heap_walk(extent_in_use, &q);
+            EXPECT_NE(q.second, 1);   // free, or merged into a neighbour
+        }
+    }).join();
+    EXPECT_EQ(remote, uint64_t(N));
+}
+
+TEST(Numa, InlineFreesGoBackToTheOwningNode) {
+    if (ctl_get("arena.count") < 2) GTEST_SKIP() << "one node";
+
+    const int N = 64;
+    std::vector<void*> blocks;
+    std::thread([&]() {
+        move_to(0);
+        for (int i = 0; i < N; i++) blocks.push_back(ma::alloc<72>());
+    }).join();
+
+    std::thread([&]() {
+        move_to(1);
+        ma::free<72>(ma::alloc<72>());   // set up this thread's cache
+
+        MA_EventStats before = events();
+        for (void* p : blocks) ma::free<72>(p);
+        EXPECT_EQ(events().remote_frees - before.remote_frees, uint64_t(N));
+
+        // none of node 0's blocks was cached to be handed out here
+        for (int i = 0; i < N; i++) {
+            void* p = ma::alloc<72>();
+            EXPECT_EQ(span_of(p).node, 1u);
+            ma::free<72>(p);
+        }
+    }).join();
+}
+
+TEST(Numa, MovingAThreadFlushesItsCache) {
+    if (ctl_get("arena.count") < 2) GTEST_SKIP() << "one node";
+
+    std::thread([]() {
+        move_to(0);
+        void* p = ma_malloc(48);
+        EXPECT_EQ(span_of(p).node, 0u);
+        ma_free(p);   // cached on node 0
+
+        move_to(1);
+        // p's run emptied and was unmapped: q may even reuse the address
+        void* q = ma_malloc(48);
+        EXPECT_EQ(span_of(q).node, 1u);
+        ma_free(q);
+    }).join();
+}
@@ -0,0 +1,130 @@
+#include "../include/memalloc/memalloc.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+struct Widget {
+    std::mutex lock;
+    uint32_t   magic;
+    uint32_t   state;
+    char       header[40];
+};
+
+static std::atomic<int> g_ctors{0};
+static std::atomic<int> g_dtors{0};
+
+static void widget_ctor(void* p) {
+    Widget* w = new (p) Widget;
+    w->magic = 0xC0FFEE;
+    w->state = 0;
+    g_ctors++;
+}
+
+static void widget_dtor(void* p) {
+    static_cast<Widget*>(p)->~Widget();
+    g_dtors++;
+}
+
+TEST(ObjCache, RejectsBadArguments) {
+    EXPECT_EQ(ma_cache_create(0, 0, nullptr, nullptr), nullptr);
+    EXPECT_EQ(ma_cache_create(64, 24, nullptr, nullptr), nullptr);
+    EXPECT_EQ(ma_cache_create(1 << 20, 0, nullptr, nullptr), nullptr);
+}
+
+TEST(ObjCache, FreedObjectsStayConstructed) {
+    MA_Cache* c = ma_cache_create(sizeof(Widget), alignof(Widget), widget_ctor, widget_dtor);
+    ASSERT_NE(c, nullptr);
+
+    Widget* w = static_cast<Widget*>(ma_cache_alloc(c));
+    ASSERT_NE(w, nullptr);
+    EXPECT_EQ(w->magic, 0xC0FFEEu);
+    w->state = 7;
+    w->lock.lock();
+    w->lock.unlock();
+    ma_cache_free(c, w);
+
+    int ctors = g_ctors.load();
+    Widget* again = static_cast<Widget*>(ma_cache_alloc(c));
+    EXPECT_EQ(again, w);
+    EXPECT_EQ(again->magic, 0xC0FFEEu);
+    EXPECT_EQ(again->state, 7u);   // left as it was freed
+    EXPECT_EQ(g_ctors.load(), ctors);
+    ma_cache_free(c, again);
+
+    ma_cache_destroy(c);
+}
+
+TEST(ObjCache, AlignmentAndSeparateRuns) {
+    MA_Cache* c = ma_cache_create(100, 256, nullptr, nullptr);
+    ASSERT_NE(c, nullptr);
+
+    std::vector<void*> objs;
+    for (int i = 0; i < 1000; i++) {
+        void* p = ma_cache_alloc(c);
+        ASSERT_NE(p, nullptr);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % 256, 0u);
+        objs.push_back(p);
+    }
+    // not interleaved with ordinary 100-byte allocations
+    void* plain = ma_malloc(100);
+    for (void* p : objs)
+        EXPECT_NE(reinterpret_cast<uintptr_t>(p) >> 16, reinterpret_cast<uintptr_t>(plain) >> 16);
+    ma_free(plain);
+
+    for (void* p : objs) ma_cache_free(c, p);
+    ma_cache_destroy(c);
+}
+
+TEST(ObjCache, DestroyRunsDestructors) {
+    int ctors0 = g_ctors.load(), dtors0 = g_dtors.load();
+
+    MA_Cache* c = ma_cache_create(sizeof(Widget), alignof(Widget), widget_ctor, widget_dtor);
+    ASSERT_NE(c, nullptr);
+    std::vector<void*> objs;
+    for (int i = 0; i < 2000; i++) objs.push_back(ma_cache_alloc(c));
+    for (void* p : objs) ma_cache_free(c, p);
+    ma_cache_destroy(c);
+
+    int built = g_ctors.load() - ctors0;
+    EXPECT_GE(built, 2000);
+    EXPECT_EQ(g_dtors.load() - dtors0, built);
+}
+
+TEST(ObjCache, CrossThreadAndPlainFree) {
+    MA_Cache* c = ma_cache_create(48, 0, nullptr, nullptr);
+    ASSERT_NE(c, nullptr);
+
+    const int N = 5000;
+    std::vector<void*> objs(N);
+    std::thread producer([&]() {
+        for (int i = 0; i < N; i++) objs[i] = ma_cache_alloc(c);
+    });
+    producer.join();
+
+    std::thread consumer([&]() {
+        for (int i = 0; i < N; i++) {
+            if (i & 1) ma_free(objs[i]);    // ma_free routes to the cache
+            else       ma_cache_free(c, objs[i]);
+        }
+    });
+    consumer.join();
+
+    void* p = ma_cache_alloc(c);
+    EXPECT_NE(p, nullptr);
+    ma_cache_free(c, p);
+    ma_cache_destroy(c);
+}
+
+TEST(ObjCache, IdsAreReused) {
+    // more create/destroy cycles than table slots
+    for (int i = 0; i < 300; i++) {
+        MA_Cache* c = ma_cache_create(32, 0, nullptr, nullptr);
+        ASSERT_NE(c, nullptr);
+        ma_cache_free(c, ma_cache_alloc(c));
+        ma_cache_destroy(c);
+    }
+}
@@ -0,0 +1,176 @@
+#include "../include/memalloc/memalloc.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static constexpr size_t HEAP_SIZE = 64ull << 20;
+
+struct Node {
+    Node*  next;
+    size_t value;
+    char*  payload;      // heap block of payload_size bytes, filled with value
+    size_t payload_size;
+};
+
+// a file path and an address range nothing else is using
+struct HeapFile {
+    std::string path = "/tmp/memalloc_pheap_" + std::to_string(getpid()) + "_" +
+                       ::testing::UnitTest::GetInstance()->current_test_info()->name();
+    void*       base = nullptr;
+
+    HeapFile() {
+        void* probe = mmap(nullptr, HEAP_SIZE + 65536, PROT_NONE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        base = reinterpret_cast<void*>((reinterpret_cast<uintptr_t>(probe) + 65535) & ~uintptr_t(65535));
+        munmap(probe, HEAP_SIZE + 65536);
+        unlink(path.c_str());
+    }
+    ~HeapFile() { unlink(path.c_str()); }
+};
+
+// a list of count nodes with payloads of increasing size, small and arena
+static Node* build_list(MA_PHeap* h, size_t count) {
+    Node* head = nullptr;
+    for (size_t i = 0; i < count; i++) {
+        Node* n = static_cast<Node*>(ma_pheap_alloc(h, sizeof(Node)));
+        if (!n) return nullptr;
+        n->value        = i;
+        n->payload_size = 16 + i * 97 % 6000;
+        n->payload      = static_cast<char*>(ma_pheap_alloc(h, n->payload_size));
+        if (!n->payload) return nullptr;
+        memset(n->payload, static_cast<int>(i & 0xFF), n->payload_size);
+        n->next = head;
+        head    = n;
+    }
+    return head;
+}
+
+static size_t check_list(Node* n) {
+    size_t count = 0;
+    for (; n; n = n->next, count++)
+        for (size_t j = 0; j < n->payload_size; j++)
+            if (n->payload[j] != static_cast<char>(n->value & 0xFF)) return SIZE_MAX;
+    return count;
+}
+
+static void free_list(MA_PHeap* h, Node* n) {
+    while (n) {
+        Node* next = n->next;
+        ma_pheap_free(h, n->payload);
+        ma_pheap_free(h, n);
+        n = next;
+    }
+}
+
+TEST(PHeap, ReopenFindsRootAndData) {
+    HeapFile f;
+    MA_PHeap* h = ma_pheap_open(f.path.c_str(), f.base, HEAP_SIZE);
+    ASSERT_NE(h, nullptr);
+    EXPECT_EQ(ma_pheap_recovered(h), 0);
+    EXPECT_EQ(ma_pheap_root(h), nullptr);
+
+    // the file is locked while open
+    EXPECT_EQ(ma_pheap_open(f.path.c_str(), nullptr, 0), nullptr);
+
+    Node* list = build_list(h, 500);
+    ASSERT_NE(list, nullptr);
+    ma_pheap_set_root(h, list);
+    EXPECT_EQ(ma_pheap_sync(h), 0);
+    ma_pheap_close(h);
+
+    h = ma_pheap_open(f.path.c_str(), nullptr, 0);
+    ASSERT_NE(h, nullptr);
+    EXPECT_EQ(ma_pheap_recovered(h), 0);
+    ASSERT_EQ(ma_pheap_root(h), list);
+    EXPECT_EQ(check_list(list), 500u);
+
+    free_list(h, list);
+    ma_pheap_set_root(h, nullptr);
+    ma_pheap_close(h);
+
+    // created with another base: refused
+    void* other = static_cast<char*>(f.base) + 65536;
+    EXPECT_EQ(ma_pheap_open(f.path.c_str(), other, HEAP_SIZE), nullptr);
+}
+
+TEST(PHeap, RecoversAfterCrash) {
+    HeapFile f;
+
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        MA_PHeap* h = ma_pheap_open(f.path.c_str(), f.base, HEAP_SIZE);
+        if (!h) _exit(1);
+        Node* list = build_list(h, 300);
+        if (!list) _exit(2);
+        ma_pheap_set_root(h, list);
+
+        // churn after the root is set: frees and splits land before the crash
+        Node* extra = build_list(h, 100);
+        free_list(h, extra);
+        ma_pheap_alloc(h, 40000);   // never linked: leaks
+        _exit(0);                   // no ma_pheap_close
+    }
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(WEXITSTATUS(status), 0);
+
+    MA_PHeap* h = ma_pheap_open(f.path.c_str(), f.base, HEAP_SIZE);
+    ASSERT_NE(h, nullptr);
+    EXPECT_EQ(ma_pheap_recovered(h), 1);
+
+    Node* list = static_cast<Node*>(ma_pheap_root(h));
+    ASSERT_NE(list, nullptr);
+    EXPECT_EQ(check_list(list), 300u);
+
+    // the rebuilt free lists hand out memory that doesn't overlap live data
+    Node* more = build_list(h, 300);
+    ASSERT_NE(more, nullptr);
+    EXPECT_EQ(check_list(list), 300u);
+    EXPECT_EQ(check_list(more), 300u);
+
+    free_list(h, more);
+    free_list(h, list);
+    ma_pheap_close(h);
+
+    h = ma_pheap_open(f.path.c_str(), f.base, HEAP_SIZE);
+    ASSERT_NE(h, nullptr);
+    EXPECT_EQ(ma_pheap_recovered(h), 0);
+    ma_pheap_close(h);
+}
+
+TEST(PHeap, FreedSpaceIsReusedAcrossReopen) {
+    HeapFile f;
+    MA_PHeap* h = ma_pheap_open(f.path.c_str(), f.base, HEAP_SIZE);
+    ASSERT_NE(h, nullptr);
+
+    void* pin   = ma_pheap_alloc(h, 64);   // keeps the small run alive
+    void* small = ma_pheap_alloc(h, 64);
+    void* large = ma_pheap_alloc(h, 20000);
+    ASSERT_NE(small, nullptr);
+    ASSERT_NE(large, nullptr);
+    ma_pheap_set_root(h, pin);
+
+    ma_pheap_free(h, small);
+    ma_pheap_free(h, large);
+    EXPECT_EQ(ma_pheap_alloc(h, 64), small);
+    EXPECT_EQ(ma_pheap_alloc(h, 20000), large);
+
+    ma_pheap_free(h, small);
+    ma_pheap_free(h, large);
+    ma_pheap_close(h);
+
+    h = ma_pheap_open(f.path.c_str(), f.base, HEAP_SIZE);
+    ASSERT_NE(h, nullptr);
+    EXPECT_EQ(ma_pheap_alloc(h, 64), small);
+    EXPECT_EQ(ma_pheap_alloc(h, 20000), large);
+
+    // past max_size: NULL, heap still usable
+    EXPECT_EQ(ma_pheap_alloc(h, HEAP_SIZE), nullptr);
+    EXPECT_NE(ma_pheap_alloc(h, 100), nullptr);
+    ma_pheap_close(h);
+}
@@ -0,0 +1,83 @@
+#include "../include/memalloc/memalloc.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+static MA_EventStats events() {
+    MA_EventStats e;
+    ma_event_stats(&e);
+    return e;
+}
+
+TEST(Reserve, RejectsBadSizes) {
+    size_t zero[]  = {64, 0};
+    size_t large[] = {1 << 20};
+    EXPECT_EQ(ma_thread_warmup(zero, 2, 4), -1);
+    EXPECT_EQ(ma_thread_warmup(large, 1, 4), -1);
+    EXPECT_EQ(ma_thread_warmup(nullptr, 0, 4), 0);
+}
+
+TEST(Reserve, ReservedRunsSkipMapping) {
+    const int RUNS = 8;
+    ASSERT_EQ(ma_reserve(RUNS * 65536, MA_RESERVE_RUNS | MA_RESERVE_POPULATE), 0);
+
+    // a fresh thread has no runs, so each class it touches needs one
+    MA_EventStats before = events();
+    std::thread t([]() {
+        std::vector<void*> ptrs;
+        for (int i = 0; i < RUNS; i++) ptrs.push_back(ma_malloc(8 + 48 * i));
+        for (void* p : ptrs) {
+            ASSERT_NE(p, nullptr);
+            memset(p, 0xAB, 8);
+        }
+        for (void* p : ptrs) ma_free(p);
+    });
+    t.join();
+    MA_EventStats after = events();
+
+    EXPECT_GE(after.tcache_refills - before.tcache_refills, uint64_t(RUNS));
+    EXPECT_EQ(after.runs_mapped, before.runs_mapped);
+}
+
+TEST(Reserve, ReservedArenaSkipsNewRegion) {
+    const size_t MB = 1 << 20;
+    ASSERT_EQ(ma_reserve(8 * MB, MA_RESERVE_ARENA | MA_RESERVE_POPULATE), 0);
+
+    MA_EventStats before = events();
+    std::vector<void*> ptrs;
+    for (int i = 0; i < 4; i++) {
+        void* p = ma_malloc(MB);
+        ASSERT_NE(p, nullptr);
+        memset(p, 0xCD, MB);
+        ptrs.push_back(p);
+    }
+    EXPECT_EQ(events().regions_mapped, before.regions_mapped);
+    for (void* p : ptrs) ma_free(p);
+}
+
+TEST(Reserve, WarmupMakesFirstAllocationsHits) {
+    std::thread t([]() {
+        size_t sizes[] = {64, 4096};
+        ASSERT_EQ(ma_thread_warmup(sizes, 2, 8), 0);
+
+        MA_EventStats before = events();
+        MA_Stats      st0;
+        ma_stats(&st0);
+
+        std::vector<void*> ptrs;
+        for (int i = 0; i < 8; i++) {
+            ptrs.push_back(ma_malloc(64));
+            ptrs.push_back(ma_malloc(4096));
+        }
+
+        // no refills and nothing carved from the arena's free list
+        MA_Stats st1;
+        ma_stats(&st1);
+        EXPECT_EQ(events().tcache_refills, before.tcache_refills);
+        EXPECT_EQ(st1.bytes_free, st0.bytes_free);
+
+        for (void* p : ptrs) ma_free(p);
+    });
+    t.join();
+}
@@ -0,0 +1,252 @@
+#include "../include/memalloc/memalloc.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+static constexpr size_t HEAP_SIZE = 16ull << 20;
+
+// fork, run fn in the child, and return its exit status
+template <typename F>
+static int in_child(F&& fn) {
+    pid_t pid = fork();
+    if (pid == 0) _exit(fn());
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+TEST(ShmHeap, AllocatesAcrossSizes) {
+    MA_ShmHeap* h = ma_shm_create("test", HEAP_SIZE);
+    ASSERT_NE(h, nullptr);
+    EXPECT_GE(ma_shm_fd(h), 0);
+
+    std::vector<std::pair<char*, size_t>> blocks;
+    for (size_t size : {1, 48, 500, 1000, 3000, 16384, 16385, 200000}) {
+        for (int i = 0; i < 5; i++) {
+            char* p = static_cast<char*>(ma_shm_alloc(h, size));
+            ASSERT_NE(p, nullptr) << size;
+            memset(p, int(size & 0x7F), size);
+            blocks.push_back({p, size});
+
+            size_t off = ma_shm_offset(h, p);
+            EXPECT_NE(off, 0u);
+            EXPECT_EQ(ma_shm_ptr(h, off), p);
+        }
+    }
+    for (auto& [p, size] : blocks) {
+        for (size_t i = 0; i < size; i += 97) ASSERT_EQ(p[i], char(size & 0x7F)) << size;
+        ma_shm_free(h, p);
+    }
+
+    EXPECT_EQ(ma_shm_offset(h, nullptr), 0u);
+    EXPECT_EQ(ma_shm_offset(h, &blocks), 0u);
+    EXPECT_EQ(ma_shm_ptr(h, 0), nullptr);
+    EXPECT_EQ(ma_shm_ptr(h, HEAP_SIZE), nullptr);
+
+    // everything went back: the whole heap can be had in one span again
+    void* big = ma_shm_alloc(h, HEAP_SIZE - (1u << 20));
+    EXPECT_NE(big, nullptr);
+    ma_shm_free(h, big);
+    EXPECT_EQ(ma_shm_alloc(h, HEAP_SIZE + 1), nullptr);
+    ma_shm_detach(h);
+}
+
+TEST(ShmHeap, RejectsBadArguments) {
+    errno = 0;
+    EXPECT_EQ(ma_shm_create("tiny", 4096), nullptr);
+    EXPECT_EQ(errno, EINVAL);
+
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    EXPECT_EQ(ma_shm_attach(fds[0]), nullptr);   // not a heap
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(ShmHeap, IgnoresFreesOutsideARunsBlocks) {
+    MA_ShmHeap* h = ma_shm_create("stray", HEAP_SIZE);
+    ASSERT_NE(h, nullptr);
+    const size_t RUN = 64 << 10;
+
+    // a pointer into the run header: 8-byte blocks line up with it
+    // wherever it falls
+    char* small = static_cast<char*>(ma_shm_alloc(h, 8));
+    ASSERT_NE(small, nullptr);
+    char* header = small - ma_shm_offset(h, small) % RUN + 8;
+    ma_shm_free(h, header);
+
+    // the slack past a 16KB run's three blocks; a block there would run
+    // into the next chunk. big is the fresh run's first block
+    char* big = static_cast<char*>(ma_shm_alloc(h, 16384));
+    ASSERT_NE(big, nullptr);
+    char* slack = big + 3 * 16384;
+    ASSERT_LT(size_t(slack - (big - ma_shm_offset(h, big) % RUN)), RUN);
+    ma_shm_free(h, slack);
+
+    std::vector<void*> blocks;
+    for (int i = 0; i < 64; i++) {
+        void* p = ma_shm_alloc(h, 8);
+        ASSERT_NE(p, nullptr);
+        EXPECT_NE(p, header);
+        blocks.push_back(p);
+    }
+    for (int i = 0; i < 4; i++) {
+        void* p = ma_shm_alloc(h, 16384);
+        ASSERT_NE(p, nullptr);
+        EXPECT_NE(p, slack);
+        blocks.push_back(p);
+    }
+    for (void* p : blocks) ma_shm_free(h, p);
+    ma_shm_free(h, small);
+    ma_shm_free(h, big);
+
+    void* whole = ma_shm_alloc(h, HEAP_SIZE - (1u << 20));
+    EXPECT_NE(whole, nullptr);
+    ma_shm_free(h, whole);
+    ma_shm_detach(h);
+}
+
+TEST(ShmHeap, SecondHandleSharesBlocksByOffset) {
+    MA_ShmHeap* a = ma_shm_create("share", HEAP_SIZE);
+    ASSERT_NE(a, nullptr);
+    MA_ShmHeap* b = ma_shm_attach(ma_shm_fd(a));
+    ASSERT_NE(b, nullptr);
+
+    // same bytes, different mapping
+    char* pa = static_cast<char*>(ma_shm_alloc(a, 256));
+    ASSERT_NE(pa, nullptr);
+    strcpy(pa, "hello");
+    char* pb = static_cast<char*>(ma_shm_ptr(b, ma_shm_offset(a, pa)));
+    ASSERT_NE(pb, nullptr);
+    EXPECT_NE(pb, pa);
+    EXPECT_STREQ(pb, "hello");
+
+    // b frees a's blocks onto their run's remote stack; a gets them back
+    const int N = 40;
+    std::vector<size_t> offs;
+    for (int i = 0; i < N; i++) offs.push_back(ma_shm_offset(a, ma_shm_alloc(a, 256)));
+    for (size_t off : offs) ma_shm_free(b, ma_shm_ptr(b, off));
+    ma_shm_free(b, pb);
+
+    std::vector<size_t> again;
+    for (int i = 0; i <= N; i++) again.push_back(ma_shm_offset(a, ma_shm_alloc(a, 256)));
+    offs.push_back(ma_shm_offset(a, pa));
+    std::sort(offs.begin(), offs.end());
+    std::sort(again.begin(), again.end());
+    EXPECT_EQ(again, offs);
+
+    for (size_t off : again) ma_shm_free(a, ma_shm_ptr(a, off));
+    ma_shm_detach(b);
+    ma_shm_detach(a);
+}
+
+TEST(ShmHeap, HandsBuffersToAnotherProcess) {
+    MA_ShmHeap* h = ma_shm_create("handoff", HEAP_SIZE);
+    ASSERT_NE(h, nullptr);
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+
+    // the child fills buffers and sends their offsets; the parent frees them
+    int fd     = ma_shm_fd(h);
+    int status = in_child([&]() {
+        MA_ShmHeap* c = ma_shm_attach(fd);
+        if (!c) return 1;
+        for (size_t size : {64, 2000, 100000}) {
+            char* p = static_cast<char*>(ma_shm_alloc(c, size));
+            if (!p) return 2;
+            memset(p, 'x', size);
+            size_t off = ma_shm_offset(c, p);
+            if (write(fds[1], &off, sizeof(off)) != sizeof(off)) return 3;
+        }
+        ma_shm_detach(c);
+        return 0;
+    });
+    close(fds[1]);
+    ASSERT_EQ(status, 0);
+
+    size_t off;
+    int    got = 0;
+    while (read(fds[0], &off, sizeof(off)) == sizeof(off)) {
+        char* p = static_cast<char*>(ma_shm_ptr(h, off));
+        ASSERT_NE(p, nullptr);
+        EXPECT_EQ(p[0], 'x');
+        EXPECT_EQ(p[63], 'x');
+        ma_shm_free(h, p);
+        got++;
+    }
+    close(fds[0]);
+    EXPECT_EQ(got, 3);
+    ma_shm_detach(h);
+}
+
+TEST(ShmHeap, DeadProcessSlotIsReclaimed) {
+    MA_ShmHeap* h = ma_shm_create("reap", HEAP_SIZE);
+    ASSERT_NE(h, nullptr);
+
+    // each child takes a slot and exits without detaching; once all 64 were
+    // held by children still counted as alive, attach would fail with EBUSY
+    int fd = ma_shm_fd(h);
+    for (int i = 0; i < 80; i++) {
+        int status = in_child([&]() {
+            MA_ShmHeap* c = ma_shm_attach(fd);
+            return c && ma_shm_alloc(c, 128) ? 0 : 1;
+        });
+        ASSERT_EQ(status, 0) << i;
+    }
+
+    // the children's runs were orphaned, and this process can adopt them
+    MA_ShmHeap* b = ma_shm_attach(fd);
+    ASSERT_NE(b, nullptr);
+    void* p = ma_shm_alloc(b, 128);
+    EXPECT_NE(p, nullptr);
+    ma_shm_free(b, p);
+    ma_shm_detach(b);
+    ma_shm_detach(h);
+}
+
+TEST(ShmHeap, SurvivesProcessKilledMidUpdate) {
+    MA_ShmHeap* h = ma_shm_create("kill", HEAP_SIZE);
+    ASSERT_NE(h, nullptr);
+
+    // children churn spans until killed; some die holding the header lock
+    int fd = ma_shm_fd(h);
+    for (int i = 0; i < 20; i++) {
+        int ready[2];
+        ASSERT_EQ(pipe(ready), 0);
+        pid_t pid = fork();
+        if (pid == 0) {
+            MA_ShmHeap* c = ma_shm_attach(fd);
+            if (!c) _exit(1);
+            char go = 1;
+            if (write(ready[1], &go, 1) != 1) _exit(1);
+            for (;;) ma_shm_free(c, ma_shm_alloc(c, 128 << 10));
+        }
+        char go = 0;
+        ASSERT_EQ(read(ready[0], &go, 1), 1) << i;
+        usleep(500 + i * 100);
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+        close(ready[0]);
+        close(ready[1]);
+    }
+
+    // each child left at most one 128KB span behind
+    MA_ShmHeap* b = ma_shm_attach(fd);
+    ASSERT_NE(b, nullptr);
+    std::vector<void*> spans;
+    while (void* p = ma_shm_alloc(b, 1 << 20)) spans.push_back(p);
+    EXPECT_GE(spans.size(), 10u);
+    size_t first = spans.size();
+    for (void* p : spans) ma_shm_free(b, p);
+    spans.clear();
+    while (void* p = ma_shm_alloc(b, 1 << 20)) spans.push_back(p);
+    EXPECT_EQ(spans.size(), first);
+    for (void* p : spans) ma_shm_free(b, p);
+    ma_shm_detach(b);
+    ma_shm_detach(h);
+}
@@ -0,0 +1,72 @@
+#include "../include/memalloc/memalloc.h"
+#include <gtest/gtest.h>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// built against memalloc_single (MA_SINGLE_THREADED=1), see CMakeLists.txt
+
+TEST(Single, ReportsTheBuild) {
+    size_t single = 0;
+    ASSERT_EQ(ma_ctl("thread.single", &single, nullptr), 0);
+    EXPECT_EQ(single, 1u);
+}
+
+TEST(Single, AllocatesEverySize) {
+    std::vector<void*> blocks;
+    for (size_t size = 8; size <= (1 << 20); size = size * 3 / 2 + 8) {
+        void* p = ma_malloc(size);
+        ASSERT_NE(p, nullptr) << size;
+        memset(p, int(size & 0xFF), size);
+        blocks.push_back(p);
+    }
+    for (size_t i = 0; i < blocks.size(); i += 2) {
+        blocks[i] = ma_realloc(blocks[i], 300);
+        ASSERT_NE(blocks[i], nullptr);
+    }
+    for (void* p : blocks) ma_free(p);
+
+    MA_Stats s;
+    ma_stats(&s);
+    EXPECT_LE(s.slab_in_use, s.slab_capacity);
+}
+
+TEST(Single, StartsNoThreadsOfItsOwn) {
+    MA_BackgroundConfig cfg{10, 100};
+    EXPECT_EQ(ma_background_start(&cfg), -1);
+
+    size_t one = 1;
+    EXPECT_EQ(ma_ctl("background.enabled", nullptr, &one), EPERM);
+    size_t running = 1;
+    ASSERT_EQ(ma_ctl("background.enabled", &running, nullptr), 0);
+    EXPECT_EQ(running, 0u);
+
+    EXPECT_EQ(ma_trace_start("ma_test_single_trace.bin"), -1);
+}
+
+TEST(Single, ThreadsOutsideTheHeapAreFine) {
+    void* p = ma_malloc(64);
+    ASSERT_NE(p, nullptr);
+
+    int sum = 0;
+    std::thread t([&sum]() {
+        for (int i = 0; i < 1000; i++) sum += i;
+    });
+    t.join();
+    EXPECT_EQ(sum, 499500);
+
+    ma_free(p);
+    ma_free(ma_malloc(64));
+}
+
+TEST(SingleDeathTest, SecondAllocatingThreadAborts) {
+    testing::FLAGS_gtest_death_test_style = "threadsafe";
+    EXPECT_DEATH(
+        {
+            ma_free(ma_malloc(64));
+            std::thread t([]() { ma_free(ma_malloc(64)); });
+            t.join();
+        },
+        "a second thread allocated");
+}
@@ -0,0 +1,101 @@
+#include "../include/memalloc/memalloc.h"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+TEST(Stats, ExitedThreadsAreFolded) {
+    MA_Stats before;
+    ma_stats(&before);
+
+    const int THREADS = 16;
+    const int OPS     = 100;   // well below any batching threshold
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([]() {
+            for (int i = 0; i < OPS; i++) ma_free(ma_malloc(40));
+        });
+    }
+    for (auto& th : threads) th.join();
+
+    MA_Stats after;
+    ma_stats(&after);
+    EXPECT_EQ(after.bytes_requested - before.bytes_requested,
+              size_t(THREADS) * OPS * 40);
+    EXPECT_EQ(after.bytes_allocated, before.bytes_allocated);
+}
+
+TEST(Stats, LiveThreadsAreVisible) {
+    MA_Stats before;
+    ma_stats(&before);
+
+    std::atomic<bool> allocated{false}, done{false};
+    void* p = nullptr;
+    std::thread worker([&]() {
+        p = ma_malloc(1000);
+        allocated.store(true);
+        while (!done.load()) std::this_thread::yield();
+        ma_free(p);
+    });
+    while (!allocated.load()) std::this_thread::yield();
+
+    MA_Stats during;
+    ma_stats(&during);
+    EXPECT_EQ(during.bytes_requested - before.bytes_requested, 1000u);
+    EXPECT_EQ(during.bytes_allocated - before.bytes_allocated, 1000u);
+
+    done.store(true);
+    worker.join();
+
+    MA_Stats after;
+    ma_stats(&after);
+    EXPECT_EQ(after.bytes_allocated, before.bytes_allocated);
+}
+
+TEST(Stats, CrossThreadFreeBalances) {
+    MA_Stats before;
+    ma_stats(&before);
+
+    const int N = 500;
+    std::vector<void*> ptrs(N);
+    std::thread producer([&]() {
+        for (int i = 0; i < N; i++) ptrs[i] = ma_malloc(2048);
+    });
+    producer.join();
+    std::thread consumer([&]() {
+        for (int i = 0; i < N; i++) ma_free(ptrs[i]);
+    });
+    consumer.join();
+
+    MA_Stats after;
+    ma_stats(&after);
+    EXPECT_EQ(after.bytes_allocated, before.bytes_allocated);
+}
+
+TEST(Stats, SlowPathEventsCount) {
+    MA_EventStats before;
+    ma_event_stats(&before);
+
+    // allocate on one thread, free on another: past the freeing thread's
+    // cache limit the blocks go back through the owner run's remote stack
+    const int N = 2000;
+    std::vector<void*> ptrs(N);
+    std::thread owner([&]() {
+        for (int i = 0; i < N; i++) ptrs[i] = ma_malloc(48);
+    });
+    owner.join();
+    std::thread remote([&]() {
+        for (int i = 0; i < N; i++) ma_free(ptrs[i]);
+    });
+    remote.join();
+
+    MA_EventStats after;
+    ma_event_stats(&after);
+    EXPECT_GT(after.tcache_refills, before.tcache_refills);
+    EXPECT_GT(after.runs_mapped,    before.runs_mapped);
+    EXPECT_GT(after.remote_frees,   before.remote_frees);
+    // contention is up to the scheduler, but any wait that happened was timed
+    if (after.lock_waits > before.lock_waits) {
+        EXPECT_GT(after.lock_wait_ns, before.lock_wait_ns);
+    }
+}
@@ -0,0 +1,84 @@
+#include "../include/memalloc/memalloc.h"
+#include "../src/trace.h"
+#include <gtest/gtest.h>
+#include <array>
+#include <cstdio>
+#include <map>
+#include <thread>
+#include <vector>
+
+using OpCounts = std::array<size_t, 4>;   // indexed by TraceOp
+
+// events per recording thread, by op; false if the file isn't a whole trace
+static bool read_trace(const char* path, std::map<uint32_t, OpCounts>& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+
+    ma::TraceFileHeader hdr;
+    bool ok = fread(&hdr, sizeof(hdr), 1, f) == 1 && hdr.magic == ma::TRACE_MAGIC &&
+              hdr.version == ma::TRACE_VERSION && hdr.event_size == sizeof(ma::TraceEvent);
+
+    ma::TraceChunkHeader ch;
+    while (ok && fread(&ch, sizeof(ch), 1, f) == 1) {
+        OpCounts& counts = out.try_emplace(ch.tid, OpCounts{}).first->second;
+        for (uint32_t i = 0; ok && i < ch.count; i++) {
+            ma::TraceEvent e;
+            ok = fread(&e, sizeof(e), 1, f) == 1 && ma::trace_op(e) >= ma::TRACE_MALLOC &&
+                 ma::trace_op(e) <= ma::TRACE_REALLOC;
+            if (ok) counts[ma::trace_op(e)]++;
+        }
+    }
+    fclose(f);
+    remove(path);
+    return ok;
+}
+
+TEST(Trace, RecordsEveryThread) {
+    const char* path = "ma_test_trace.bin";
+    if (ma_trace_start(path) != 0) GTEST_SKIP() << "built without ENABLE_TRACE";
+
+    const int THREADS = 4;
+    const int OPS     = 3000;   // spans several per-thread buffers
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([]() {
+            for (int i = 0; i < OPS; i++) {
+                void* p = ma_malloc(16 + i % 1000);
+                p = ma_realloc(p, 2000);
+                ma_free(p);
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    ma_trace_stop();
+
+    std::map<uint32_t, OpCounts> multi;
+    ASSERT_TRUE(read_trace(path, multi));
+    ASSERT_EQ(multi.size(), size_t(THREADS));
+    for (const auto& [tid, counts] : multi) {
+        EXPECT_EQ(counts[ma::TRACE_MALLOC], size_t(OPS)) << "tid " << tid;
+        EXPECT_EQ(counts[ma::TRACE_REALLOC], size_t(OPS)) << "tid " << tid;
+        EXPECT_EQ(counts[ma::TRACE_FREE], size_t(OPS)) << "tid " << tid;
+    }
+
+    // a second start must work once the first trace is closed
+    const char* empty_path = "ma_test_trace_empty.bin";
+    ASSERT_EQ(ma_trace_start(empty_path), 0);
+    ma_trace_stop();
+    std::map<uint32_t, OpCounts> empty;
+    ASSERT_TRUE(read_trace(empty_path, empty));
+    EXPECT_TRUE(empty.empty());
+
+    const char* single_path = "ma_test_trace_single.bin";
+    ASSERT_EQ(ma_trace_start(single_path), 0);
+    for (int i = 0; i < OPS; i++) ma_free(ma_malloc(64));
+    ma_trace_stop();
+    std::map<uint32_t, OpCounts> single;
+    ASSERT_TRUE(read_trace(single_path, single));
+    ASSERT_EQ(single.size(), 1u);
+    const OpCounts& counts = single.begin()->second;
+    EXPECT_EQ(counts[ma::TRACE_MALLOC], size_t(OPS));
+    EXPECT_EQ(counts[ma::TRACE_FREE], size_t(OPS));
+    EXPECT_EQ(counts[ma::TRACE_REALLOC], 0u);
+    EXPECT_TRUE(multi.find(single.begin()->first) == multi.end());
+}